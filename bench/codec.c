@@ -0,0 +1,207 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "../maze/maze-codec.h"
+
+/**
+ * The number of times every operation is repeated; the fastest run is
+ * reported.
+ */
+#define RUNS 3
+
+/**
+ * An encoded maze in memory.
+ */
+typedef struct {
+    /** The encoded data */
+    unsigned char *data;
+
+    /** The number of bytes written, the capacity and the read position */
+    size_t size, capacity, position;
+} Buffer;
+
+/**
+ * Returns the current time in seconds.
+ */
+static double
+now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Appends encoded data to a buffer.
+ *
+ * @see MazeCodecWrite
+ */
+static int
+buffer_write(void *context, const void *data, size_t size)
+{
+    Buffer *buffer = context;
+
+    if (buffer->size + size > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity : 4096;
+        unsigned char *grown;
+
+        while (capacity < buffer->size + size) {
+            capacity *= 2;
+        }
+        grown = realloc(buffer->data, capacity);
+        if (!grown) {
+            return 0;
+        }
+        buffer->data = grown;
+        buffer->capacity = capacity;
+    }
+    memcpy(buffer->data + buffer->size, data, size);
+    buffer->size += size;
+
+    return 1;
+}
+
+/**
+ * Reads encoded data from a buffer.
+ *
+ * @see MazeCodecRead
+ */
+static size_t
+buffer_read(void *context, void *data, size_t size)
+{
+    Buffer *buffer = context;
+
+    if (size > buffer->size - buffer->position) {
+        size = buffer->size - buffer->position;
+    }
+    memcpy(data, buffer->data + buffer->position, size);
+    buffer->position += size;
+
+    return size;
+}
+
+/**
+ * Checks whether two mazes have the same rooms.
+ *
+ * @param a, b
+ *     The mazes to compare. They must have the same dimensions.
+ * @return non-zero if all rooms are equal
+ */
+static int
+mazes_equal(Maze *a, Maze *b)
+{
+    unsigned int x, y;
+
+    for (y = 0; y < a->height; y++) {
+        for (x = 0; x < a->width; x++) {
+            if (maze_room_get(a, x, y) != maze_room_get(b, x, y)) {
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * Measures encoding and decoding throughput for the raw and range modes.
+ *
+ * Usage: codec [SIZE [GENERATOR...]]
+ *
+ * Throughput is given in rooms and in GB of room values, one byte per room,
+ * per second. Only the codec is timed; the data is kept in memory. Every
+ * decoded maze is compared with the original, and the program fails if they
+ * differ.
+ */
+int
+main(int argc, char *argv[])
+{
+    static const char *DEFAULT_TYPES[] = {"backtracker", "wilson",
+        "binary-tree"};
+    unsigned int size = argc > 1 ? (unsigned int)atoi(argv[1]) : 4096;
+    const char **types = argc > 2
+        ? (const char**)argv + 2
+        : DEFAULT_TYPES;
+    int type_count = argc > 2 ? argc - 2 : 3;
+    int t;
+
+    if (size == 0) {
+        fprintf(stderr, "usage: %s [SIZE [GENERATOR...]]\n", argv[0]);
+        return 1;
+    }
+
+    printf("%ux%u mazes, best of %d runs\n", size, size, RUNS);
+    printf("%-16s %-6s %10s %24s %24s\n", "generator", "mode", "bits/room",
+        "encode", "decode");
+    for (t = 0; t < type_count; t++) {
+        const MazeGeneratorType *type = maze_generator_type_find(types[t]);
+        MazeInitializeOptions options = {NULL, NULL, NULL};
+        MazeRandom random;
+        Maze *maze;
+        unsigned int mode;
+
+        if (!type) {
+            fprintf(stderr, "unknown generator: %s\n", types[t]);
+            return 1;
+        }
+        maze = maze_create(size, size);
+        if (!maze) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+        maze_random_seed(&random, 1);
+        options.random = &random;
+        if (!maze_initialize(maze, type, &options)) {
+            fprintf(stderr, "maze_initialize failed\n");
+            return 1;
+        }
+
+        for (mode = 0; mode < 2; mode++) {
+            unsigned int flags = mode ? MAZE_CODEC_RANGE : 0;
+            double rooms = (double)size * size;
+            double encode = 0.0, decode = 0.0;
+            Buffer buffer = {NULL, 0, 0, 0};
+            int run;
+
+            for (run = 0; run < RUNS; run++) {
+                double start;
+                Maze *decoded;
+
+                buffer.size = 0;
+                start = now();
+                if (!maze_encode(maze, flags, buffer_write, &buffer)) {
+                    fprintf(stderr, "maze_encode failed\n");
+                    return 1;
+                }
+                start = now() - start;
+                encode = run == 0 || start < encode ? start : encode;
+
+                buffer.position = 0;
+                start = now();
+                decoded = maze_decode(buffer_read, &buffer, NULL);
+                start = now() - start;
+                if (!decoded || !mazes_equal(maze, decoded)) {
+                    fprintf(stderr, "the decoded maze differs\n");
+                    return 1;
+                }
+                maze_free(decoded);
+                decode = run == 0 || start < decode ? start : decode;
+            }
+
+            printf("%-16s %-6s %10.2f %7.1f Mr/s %6.3f GB/s %7.1f Mr/s "
+                "%6.3f GB/s\n",
+                type->name, mode ? "range" : "raw",
+                8.0 * (buffer.size - MAZE_CODEC_HEADER_SIZE) / rooms,
+                rooms / encode / 1e6, rooms / encode / 1e9,
+                rooms / decode / 1e6, rooms / decode / 1e9);
+            free(buffer.data);
+        }
+
+        maze_free(maze);
+    }
+
+    return 0;
+}
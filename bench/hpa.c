@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <time.h>
+
+#include "../maze/maze-hpa.h"
+
+/**
+ * The cluster sizes to compare.
+ */
+static const unsigned int CLUSTER_SIZES[] = {16, 32, 64};
+
+/**
+ * Returns the current time in seconds.
+ */
+static double
+now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Compares the query latency of maze_hpa_distance and maze_hpa_solve with
+ * that of maze_solve on a Randomised Prim maze.
+ *
+ * Usage: hpa [SIZE [PAIRS [SEED]]]
+ *
+ * Every query is checked against maze_solve; the program fails if any length
+ * differs.
+ */
+int
+main(int argc, char *argv[])
+{
+    unsigned int size = argc > 1 ? (unsigned int)atoi(argv[1]) : 5000;
+    unsigned int pairs = argc > 2 ? (unsigned int)atoi(argv[2]) : 20;
+    uint64_t seed = argc > 3 ? (uint64_t)atoll(argv[3]) : 1;
+    MazeSolveWorkspace *workspace;
+    MazeRandom random;
+    Maze *maze;
+    int *points;
+    size_t *lengths;
+    double start, bfs;
+    unsigned int i, c;
+
+    if (size == 0 || pairs == 0) {
+        fprintf(stderr, "usage: %s [SIZE [PAIRS [SEED]]]\n", argv[0]);
+        return 1;
+    }
+
+    maze = maze_create(size, size);
+    workspace = maze_solve_workspace_create();
+    points = malloc(4 * pairs * sizeof(int));
+    lengths = malloc(pairs * sizeof(size_t));
+    if (!maze || !workspace || !points || !lengths) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    maze_random_seed(&random, seed);
+    start = now();
+    maze_initialize_randomized_prim_r(maze, &random, NULL, NULL);
+    printf("%ux%u Prim maze generated in %.2f s\n", size, size,
+        now() - start);
+
+    for (i = 0; i < 4 * pairs; i++) {
+        points[i] = (int)maze_random_range(&random, size);
+    }
+
+    /* The baseline; the first query grows the workspace */
+    maze_solve_workspace_reserve(workspace, maze);
+    start = now();
+    for (i = 0; i < pairs; i++) {
+        MazePath path;
+        int *p = points + 4 * i;
+
+        if (!maze_solve(maze, p[0], p[1], p[2], p[3], workspace, &path)) {
+            fprintf(stderr, "maze_solve failed\n");
+            return 1;
+        }
+        lengths[i] = path.length;
+    }
+    bfs = (now() - start) / pairs;
+
+    printf("cluster  build     distance  path      BFS\n");
+    for (c = 0; c < sizeof(CLUSTER_SIZES) / sizeof(CLUSTER_SIZES[0]); c++) {
+        MazeHpa *hpa = maze_hpa_create(maze, CLUSTER_SIZES[c]);
+        double build, distance, path;
+        size_t length;
+        MazePath steps;
+        int *p = points;
+
+        if (!hpa) {
+            fprintf(stderr, "maze_hpa_create failed\n");
+            return 1;
+        }
+
+        /* The clusters are built by the first query */
+        start = now();
+        if (!maze_hpa_distance(hpa, p[0], p[1], p[2], p[3], &length)) {
+            fprintf(stderr, "maze_hpa_distance failed\n");
+            return 1;
+        }
+        build = now() - start;
+
+        start = now();
+        for (i = 0; i < pairs; i++) {
+            p = points + 4 * i;
+            if (!maze_hpa_distance(hpa, p[0], p[1], p[2], p[3], &length)
+                    || length != lengths[i]) {
+                fprintf(stderr, "maze_hpa_distance differs from maze_solve\n");
+                return 1;
+            }
+        }
+        distance = (now() - start) / pairs;
+
+        start = now();
+        for (i = 0; i < pairs; i++) {
+            p = points + 4 * i;
+            if (!maze_hpa_solve(hpa, p[0], p[1], p[2], p[3], &steps)
+                    || steps.length != lengths[i]) {
+                fprintf(stderr, "maze_hpa_solve differs from maze_solve\n");
+                return 1;
+            }
+        }
+        path = (now() - start) / pairs;
+
+        printf("%-7u  %-6.2f s  %-6.2f ms %-6.2f ms %-6.2f ms\n",
+            CLUSTER_SIZES[c], build, distance * 1e3, path * 1e3, bfs * 1e3);
+
+        maze_hpa_free(hpa);
+    }
+
+    free(lengths);
+    free(points);
+    maze_solve_workspace_free(workspace);
+    maze_free(maze);
+
+    return 0;
+}
@@ -0,0 +1,177 @@
+#include <linux/perf_event.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../maze/maze-solve.h"
+
+/**
+ * A measurement of wall clock time and, where the system allows it, last level
+ * cache misses.
+ */
+typedef struct {
+    /** The counter, or -1 if cache misses cannot be counted */
+    int fd;
+
+    /** The start time */
+    double start;
+} Measurement;
+
+/**
+ * Returns the current time in seconds.
+ */
+static double
+now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Starts a measurement.
+ *
+ * @param measurement
+ *     The measurement to start.
+ */
+static void
+measure_start(Measurement *measurement)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    measurement->fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    if (measurement->fd >= 0) {
+        ioctl(measurement->fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(measurement->fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    measurement->start = now();
+}
+
+/**
+ * Ends a measurement and prints it.
+ *
+ * @param measurement
+ *     The measurement to end.
+ * @param name
+ *     The name of the workload.
+ * @param layout
+ *     The name of the layout.
+ */
+static void
+measure_end(Measurement *measurement, const char *name, const char *layout)
+{
+    double seconds = now() - measurement->start;
+    long long misses;
+
+    if (measurement->fd >= 0) {
+        ioctl(measurement->fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(measurement->fd, &misses, sizeof(misses))
+                == sizeof(misses)) {
+            printf("%-22s %-6s %8.2f s %14lld\n", name, layout, seconds,
+                misses);
+        }
+        else {
+            printf("%-22s %-6s %8.2f s %14s\n", name, layout, seconds, "-");
+        }
+        close(measurement->fd);
+    }
+    else {
+        printf("%-22s %-6s %8.2f s %14s\n", name, layout, seconds, "-");
+    }
+}
+
+/**
+ * Compares MAZE_LAYOUT_ROWS with MAZE_LAYOUT_TILES.
+ *
+ * Usage: layout [SIZE [SEED]]
+ *
+ * For every layout, a SIZE x SIZE maze is generated with the Recursive
+ * Backtracker, read column by column, and solved between two corners. Cache
+ * misses are only reported where perf_event_open is permitted. Both layouts
+ * store the same maze, so the program fails if their columns or paths differ.
+ */
+int
+main(int argc, char *argv[])
+{
+    static const MazeLayout LAYOUTS[] = {MAZE_LAYOUT_ROWS, MAZE_LAYOUT_TILES};
+    static const char *NAMES[] = {"rows", "tiles"};
+    unsigned int size = argc > 1 ? (unsigned int)atoi(argv[1]) : 16384;
+    uint64_t seed = argc > 2 ? (uint64_t)atoll(argv[2]) : 1;
+    uint64_t sums[2];
+    size_t lengths[2];
+    unsigned int i;
+
+    if (size == 0) {
+        fprintf(stderr, "usage: %s [SIZE [SEED]]\n", argv[0]);
+        return 1;
+    }
+
+    printf("%ux%u maze\n", size, size);
+    printf("%-22s %-6s %10s %14s\n", "workload", "layout", "time",
+        "cache misses");
+    for (i = 0; i < 2; i++) {
+        Maze *maze = maze_create_layout(size, size, LAYOUTS[i]);
+        MazeSolveWorkspace *workspace = maze_solve_workspace_create();
+        MazeInitializeOptions options = {NULL, NULL, NULL};
+        Measurement measurement;
+        MazeRandom random;
+        MazePath path;
+        uint64_t sum = 0;
+        unsigned int x, y;
+
+        if (!maze || !workspace
+                || !maze_solve_workspace_reserve(workspace, maze)) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+
+        maze_random_seed(&random, seed);
+        options.random = &random;
+        measure_start(&measurement);
+        if (!maze_initialize(maze, &MAZE_GENERATOR_BACKTRACKER, &options)) {
+            fprintf(stderr, "maze_initialize failed\n");
+            return 1;
+        }
+        measure_end(&measurement, "backtracker", NAMES[i]);
+
+        /* Every step of a column scan is a vertical step */
+        measure_start(&measurement);
+        for (x = 0; x < size; x++) {
+            for (y = 0; y < size; y++) {
+                sum = sum * 31 + maze_room_get(maze, x, y);
+            }
+        }
+        measure_end(&measurement, "column-order scan", NAMES[i]);
+        sums[i] = sum;
+
+        measure_start(&measurement);
+        if (!maze_solve(maze, 0, 0, size - 1, size - 1, workspace, &path)) {
+            fprintf(stderr, "maze_solve failed\n");
+            return 1;
+        }
+        measure_end(&measurement, "breadth first search", NAMES[i]);
+        lengths[i] = path.length;
+
+        maze_solve_workspace_free(workspace);
+        maze_free(maze);
+    }
+
+    if (sums[0] != sums[1] || lengths[0] != lengths[1]) {
+        fprintf(stderr, "the layouts store different mazes\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../maze/maze.h"
+
+/**
+ * Calculates a checksum of the walls of a maze.
+ *
+ * @param maze
+ *     The maze.
+ * @return the checksum
+ */
+static uint64_t
+checksum(Maze *maze)
+{
+    uint64_t result = 0xcbf29ce484222325ULL;
+    size_t i;
+
+    for (i = 0; i < maze->walls_size; i++) {
+        result = (result ^ maze->walls[i]) * 0x100000001b3ULL;
+    }
+
+    return result;
+}
+
+/**
+ * Measures how maze_initialize_tiled scales with the number of threads.
+ *
+ * Usage: tiled [SIZE [THREADS [GENERATOR [TILE_SIZE]]]]
+ *
+ * A SIZE x SIZE maze is initialised with 1, 2, 4 and so on up to THREADS
+ * threads, which defaults to the number of online processors. Every run uses
+ * the same seed, and the program fails if the mazes differ, since the result
+ * must not depend on the number of threads.
+ */
+int
+main(int argc, char *argv[])
+{
+    unsigned int size = argc > 1 ? (unsigned int)atoi(argv[1]) : 8192;
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned int max_threads = argc > 2
+        ? (unsigned int)atoi(argv[2])
+        : processors > 0 ? (unsigned int)processors : 1;
+    const MazeGeneratorType *type = argc > 3
+        ? maze_generator_type_find(argv[3])
+        : &MAZE_GENERATOR_RANDOMIZED_PRIM;
+    unsigned int tile_size = argc > 4 ? (unsigned int)atoi(argv[4]) : 0;
+    uint64_t expected = 0;
+    double base = 0.0;
+    unsigned int threads;
+
+    if (size == 0 || max_threads == 0 || !type) {
+        fprintf(stderr, "usage: %s [SIZE [THREADS [GENERATOR [TILE_SIZE]]]]\n",
+            argv[0]);
+        return 1;
+    }
+
+    printf("%ux%u %s maze, %ld online processors\n", size, size, type->name,
+        processors);
+    printf("threads  split     generate  join      total     Mrooms/s  "
+        "speedup\n");
+    for (threads = 1; threads <= max_threads;
+            threads = threads < max_threads && threads * 2 > max_threads
+                ? max_threads
+                : threads * 2) {
+        MazeTiledTimings timings;
+        MazeRandom random;
+        Maze *maze = maze_create(size, size);
+        uint64_t sum;
+        double total;
+
+        if (!maze) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+
+        maze_random_seed(&random, 1);
+        if (!maze_initialize_tiled(maze, type, &random, tile_size, threads,
+                NULL, NULL, &timings)) {
+            fprintf(stderr, "maze_initialize_tiled failed\n");
+            return 1;
+        }
+        total = timings.split + timings.generate + timings.join;
+        if (threads == 1) {
+            base = total;
+        }
+
+        sum = checksum(maze);
+        if (threads == 1) {
+            expected = sum;
+        }
+        else if (sum != expected) {
+            fprintf(stderr, "the maze depends on the number of threads\n");
+            return 1;
+        }
+
+        printf("%-7u  %-6.3f s  %-6.3f s  %-6.3f s  %-6.3f s  %-8.1f  "
+            "%.2f\n",
+            threads, timings.split, timings.generate, timings.join, total,
+            (double)size * size / total / 1e6, base / total);
+
+        maze_free(maze);
+        if (threads == max_threads) {
+            break;
+        }
+    }
+
+    return 0;
+}
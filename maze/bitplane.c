@@ -0,0 +1,262 @@
+#include <stdlib.h>
+
+#include "maze-bitplane.h"
+
+/**
+ * Counts the set bits of a word.
+ */
+#define popcount(word) ((uint64_t)__builtin_popcountll(word))
+
+/**
+ * Retrieves a word of a row shifted one bit towards bit 0.
+ *
+ * For the vertical plane, this moves the right door of every room to the bit
+ * of the room.
+ *
+ * @param row
+ *     The row.
+ * @param i
+ *     The index of the word.
+ * @param stride
+ *     The number of words in the row.
+ * @return the shifted word
+ */
+static inline uint64_t
+shifted(const uint64_t *row, size_t i, size_t stride)
+{
+    return (row[i] >> 1) | (i + 1 < stride ? row[i + 1] << 63 : 0);
+}
+
+/**
+ * Calculates which bits of a word correspond to rooms.
+ *
+ * @param planes
+ *     The bit planes.
+ * @param i
+ *     The index of the word in a row.
+ * @return a mask with the bits of the rooms set
+ */
+static inline uint64_t
+rooms(MazeBitplanes *planes, size_t i)
+{
+    if ((i + 1) * 64 <= planes->width) {
+        return ~(uint64_t)0;
+    }
+    else if (i * 64 >= planes->width) {
+        return 0;
+    }
+    else {
+        return ((uint64_t)1 << (planes->width % 64)) - 1;
+    }
+}
+
+/**
+ * Gathers one bit from each of eight consecutive rooms.
+ *
+ * @param walls
+ *     The walls of the rooms.
+ * @param shift
+ *     The index of the bit to gather.
+ * @return the bits, with the first room in bit 0
+ */
+static inline uint64_t
+gather(const unsigned char *walls, unsigned int shift)
+{
+    uint64_t bytes = (uint64_t)walls[0]
+        | (uint64_t)walls[1] << 8
+        | (uint64_t)walls[2] << 16
+        | (uint64_t)walls[3] << 24
+        | (uint64_t)walls[4] << 32
+        | (uint64_t)walls[5] << 40
+        | (uint64_t)walls[6] << 48
+        | (uint64_t)walls[7] << 56;
+
+    /* The multiplication moves bit 8 * i to bit 56 + i without carries */
+    return (((bytes >> shift) & 0x0101010101010101ULL)
+        * 0x0102040810204080ULL) >> 56;
+}
+
+/**
+ * Copies one row of doors of a maze to a bit plane row.
+ *
+ * @param walls
+ *     The walls of the rooms of the row.
+ * @param width
+ *     The number of rooms in the row.
+ * @param wall
+ *     The wall to copy to bit x for room x.
+ * @param last
+ *     The wall of the last room to copy to bit width, or 0.
+ * @param row
+ *     The bit plane row. All of its bits are overwritten.
+ */
+static void
+row_copy(const unsigned char *walls, unsigned int width, unsigned char wall,
+    unsigned char last, uint64_t *row)
+{
+    uint64_t word = 0;
+    unsigned int shift = __builtin_ctz(wall);
+    unsigned int x;
+
+    for (x = 0; x + 8 <= width; x += 8) {
+        word |= gather(walls + x, shift) << (x % 64);
+        if (x % 64 == 56) {
+            row[x / 64] = word;
+            word = 0;
+        }
+    }
+    for (; x < width; x++) {
+        word |= (uint64_t)((walls[x] >> shift) & 1) << (x % 64);
+    }
+    if (width > 0) {
+        word |= (uint64_t)((walls[width - 1] & last) != 0) << (width % 64);
+    }
+    row[width / 64] = word;
+}
+
+MazeBitplanes*
+maze_bitplanes_create(Maze *maze)
+{
+    MazeBitplanes *result;
+    size_t stride = maze->width / 64 + 1;
+    unsigned char *buffer;
+    unsigned int y;
+
+    result = malloc(sizeof(MazeBitplanes));
+    if (!result) {
+        return NULL;
+    }
+    result->width = maze->width;
+    result->height = maze->height;
+    result->stride = stride;
+    result->vertical = calloc(maze->height ? maze->height * stride : 1,
+        sizeof(uint64_t));
+    result->horizontal = calloc((maze->height + 1) * stride,
+        sizeof(uint64_t));
+    buffer = malloc(maze->width ? maze->width : 1);
+    if (!result->vertical || !result->horizontal || !buffer) {
+        maze_bitplanes_free(result);
+        free(buffer);
+        return NULL;
+    }
+
+    for (y = 0; y < maze->height; y++) {
+        const unsigned char *walls = maze_row_read(maze, 0, y, maze->width,
+            buffer);
+
+        row_copy(walls, maze->width, MAZE_WALL_LEFT, MAZE_WALL_RIGHT,
+            result->vertical + y * stride);
+        row_copy(walls, maze->width, MAZE_WALL_UP, 0,
+            result->horizontal + y * stride);
+        if (y == maze->height - 1) {
+            row_copy(walls, maze->width, MAZE_WALL_DOWN, 0,
+                result->horizontal + maze->height * stride);
+        }
+    }
+
+    free(buffer);
+
+    return result;
+}
+
+void
+maze_bitplanes_free(MazeBitplanes *planes)
+{
+    free(planes->vertical);
+    free(planes->horizontal);
+    free(planes);
+}
+
+uint64_t
+maze_bitplanes_door_count(MazeBitplanes *planes)
+{
+    uint64_t result = 0;
+    size_t i, count = planes->height * planes->stride;
+
+    for (i = 0; i < count; i++) {
+        result += popcount(planes->vertical[i]);
+    }
+    for (i = 0; i < count + planes->stride; i++) {
+        result += popcount(planes->horizontal[i]);
+    }
+
+    return result;
+}
+
+uint64_t
+maze_bitplanes_dead_ends(MazeBitplanes *planes, uint64_t *mask)
+{
+    uint64_t result = 0;
+    size_t stride = planes->stride;
+    unsigned int y;
+
+    for (y = 0; y < planes->height; y++) {
+        const uint64_t *vertical = planes->vertical + y * stride;
+        const uint64_t *up = planes->horizontal + y * stride;
+        const uint64_t *down = up + stride;
+        size_t i;
+
+        for (i = 0; i < stride; i++) {
+            /* Add the four doors of 64 rooms at a time: a room has exactly
+               one open door if the sum of the pairs is odd and neither pair
+               has both doors open */
+            uint64_t left = vertical[i];
+            uint64_t right = shifted(vertical, i, stride);
+            uint64_t dead = (left ^ right ^ up[i] ^ down[i])
+                & ~((left & right) | (up[i] & down[i]))
+                & rooms(planes, i);
+
+            result += popcount(dead);
+            if (mask) {
+                mask[y * stride + i] = dead;
+            }
+        }
+    }
+
+    return result;
+}
+
+void
+maze_bitplanes_corners(MazeBitplanes *planes, unsigned int y,
+    unsigned char corner, uint64_t *mask)
+{
+    size_t stride = planes->stride;
+    const uint64_t *vertical = planes->vertical + y * stride;
+    const uint64_t *up = planes->horizontal + y * stride;
+    const uint64_t *down = up + stride;
+    size_t i;
+
+    for (i = 0; i < stride; i++) {
+        uint64_t open = 0;
+
+        if (corner & MAZE_WALL_LEFT) {
+            open |= vertical[i];
+        }
+        if (corner & MAZE_WALL_UP) {
+            open |= up[i];
+        }
+        if (corner & MAZE_WALL_RIGHT) {
+            open |= shifted(vertical, i, stride);
+        }
+        if (corner & MAZE_WALL_DOWN) {
+            open |= down[i];
+        }
+        mask[i] = ~open & rooms(planes, i);
+    }
+}
+
+uint64_t
+maze_bitplanes_compare(MazeBitplanes *a, MazeBitplanes *b)
+{
+    uint64_t result = 0;
+    size_t i, count = a->height * a->stride;
+
+    for (i = 0; i < count; i++) {
+        result += popcount(a->vertical[i] ^ b->vertical[i]);
+    }
+    for (i = 0; i < count + a->stride; i++) {
+        result += popcount(a->horizontal[i] ^ b->horizontal[i]);
+    }
+
+    return result;
+}
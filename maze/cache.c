@@ -0,0 +1,584 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "maze-cache.h"
+#include "maze-file.h"
+
+/**
+ * The initial number of hash buckets.
+ */
+#define INITIAL_BUCKETS 64
+
+/**
+ * A cached maze.
+ */
+typedef struct Entry Entry;
+struct Entry {
+    /** The key of the maze */
+    unsigned int generator_id;
+    uint64_t seed;
+    unsigned int width, height;
+
+    /** The maze */
+    Maze *maze;
+
+    /** The number of bytes used by the maze */
+    size_t bytes;
+
+    /** The number of users holding the maze, including those waiting for it
+        to be generated */
+    unsigned int references;
+
+    /** Whether the maze is being generated or mapped by another thread; maze
+        is NULL until this is cleared, and remains NULL if that failed */
+    int pending;
+
+    /** The next entry in the same hash bucket */
+    Entry *hash_next;
+
+    /** The previous and next entries in order of last use, starting with the
+        most recently used entry */
+    Entry *lru_previous, *lru_next;
+};
+
+struct MazeCache {
+    /** The maximum number of bytes to use, and the current number */
+    size_t max_bytes, bytes;
+
+    /** The directory containing saved mazes, or NULL */
+    char *directory;
+
+    /** The hash buckets; the number of buckets is a power of two */
+    Entry **buckets;
+    size_t bucket_mask;
+
+    /** The number of entries */
+    size_t count;
+
+    /** The most and least recently used entries */
+    Entry *lru_first, *lru_last;
+
+    /** The counters */
+    uint64_t hits, disk_hits, misses, evictions;
+
+    /** Serialises all access to the cache */
+    pthread_mutex_t lock;
+
+    /** Signalled when a pending entry is completed */
+    pthread_cond_t completed;
+};
+
+/**
+ * Allocates memory for a cached maze.
+ *
+ * The allocator of a cached maze carries its entry as context, so that the
+ * entry of a released maze is found without a lookup.
+ */
+static void*
+entry_alloc(void *context, size_t size)
+{
+    (void)context;
+
+    return malloc(size);
+}
+
+/**
+ * Frees memory allocated by entry_alloc.
+ */
+static void
+entry_free(void *context, void *mem, size_t size)
+{
+    (void)context;
+    (void)size;
+
+    free(mem);
+}
+
+/**
+ * Calculates the hash of a key.
+ *
+ * @param generator_id, seed, width, height
+ *     The key.
+ * @return the hash
+ */
+static inline size_t
+hash(unsigned int generator_id, uint64_t seed, unsigned int width,
+    unsigned int height)
+{
+    uint64_t result = seed * 0x9e3779b97f4a7c15ULL
+        ^ (uint64_t)generator_id * 0xc2b2ae3d27d4eb4fULL
+        ^ ((uint64_t)width << 32 | height) * 0x165667b19e3779f9ULL;
+
+    return (size_t)(result ^ (result >> 29));
+}
+
+/**
+ * Removes an entry from the list of entries in order of last use.
+ *
+ * @param cache
+ *     The cache.
+ * @param entry
+ *     The entry to remove.
+ */
+static void
+lru_remove(MazeCache *cache, Entry *entry)
+{
+    if (entry->lru_previous) {
+        entry->lru_previous->lru_next = entry->lru_next;
+    }
+    else {
+        cache->lru_first = entry->lru_next;
+    }
+    if (entry->lru_next) {
+        entry->lru_next->lru_previous = entry->lru_previous;
+    }
+    else {
+        cache->lru_last = entry->lru_previous;
+    }
+}
+
+/**
+ * Inserts an entry first in the list of entries in order of last use.
+ *
+ * @param cache
+ *     The cache.
+ * @param entry
+ *     The entry to insert.
+ */
+static void
+lru_insert(MazeCache *cache, Entry *entry)
+{
+    entry->lru_previous = NULL;
+    entry->lru_next = cache->lru_first;
+    if (cache->lru_first) {
+        cache->lru_first->lru_previous = entry;
+    }
+    else {
+        cache->lru_last = entry;
+    }
+    cache->lru_first = entry;
+}
+
+/**
+ * Removes an entry from the hash buckets and the list of entries in order of
+ * last use without freeing it.
+ *
+ * @param cache
+ *     The cache.
+ * @param entry
+ *     The entry to remove.
+ */
+static void
+entry_unlink(MazeCache *cache, Entry *entry)
+{
+    Entry **p;
+
+    for (p = &cache->buckets[hash(entry->generator_id, entry->seed,
+                entry->width, entry->height) & cache->bucket_mask];
+            *p != entry;
+            p = &(*p)->hash_next);
+    *p = entry->hash_next;
+
+    lru_remove(cache, entry);
+    cache->bytes -= entry->bytes;
+    cache->count--;
+}
+
+/**
+ * Removes an entry from the cache and frees it.
+ *
+ * @param cache
+ *     The cache.
+ * @param entry
+ *     The entry to remove.
+ */
+static void
+entry_remove(MazeCache *cache, Entry *entry)
+{
+    entry_unlink(cache, entry);
+    maze_free(entry->maze);
+    free(entry);
+}
+
+/**
+ * Releases the least recently used mazes that are not in use until the cache
+ * is within its budget.
+ *
+ * @param cache
+ *     The cache.
+ */
+static void
+evict(MazeCache *cache)
+{
+    Entry *entry = cache->lru_last;
+
+    while (cache->bytes > cache->max_bytes && entry) {
+        Entry *previous = entry->lru_previous;
+
+        if (entry->references == 0) {
+            entry_remove(cache, entry);
+            cache->evictions++;
+        }
+        entry = previous;
+    }
+}
+
+/**
+ * Doubles the number of hash buckets.
+ *
+ * If memory cannot be allocated, the current buckets are kept.
+ *
+ * @param cache
+ *     The cache.
+ */
+static void
+grow(MazeCache *cache)
+{
+    size_t count = (cache->bucket_mask + 1) * 2;
+    Entry **buckets = calloc(count, sizeof(Entry*));
+    Entry *entry;
+
+    if (!buckets) {
+        return;
+    }
+
+    for (entry = cache->lru_first; entry; entry = entry->lru_next) {
+        size_t index = hash(entry->generator_id, entry->seed, entry->width,
+            entry->height) & (count - 1);
+
+        entry->hash_next = buckets[index];
+        buckets[index] = entry;
+    }
+
+    free(cache->buckets);
+    cache->buckets = buckets;
+    cache->bucket_mask = count - 1;
+}
+
+/**
+ * Builds the path of the file of a maze.
+ *
+ * @param cache
+ *     The cache. It must have a directory.
+ * @param entry
+ *     The entry whose key to use.
+ * @param suffix
+ *     A suffix appended to the file name.
+ * @return the path, which must be freed, or NULL if memory could not be
+ *     allocated
+ */
+static char*
+entry_path(MazeCache *cache, Entry *entry, const char *suffix)
+{
+    const char *format = "%s/%u-%016llx-%ux%u.maze%s";
+    int size = snprintf(NULL, 0, format, cache->directory,
+        entry->generator_id, (unsigned long long)entry->seed,
+        entry->width, entry->height, suffix);
+    char *result = malloc(size + 1);
+
+    if (result) {
+        snprintf(result, size + 1, format, cache->directory,
+            entry->generator_id, (unsigned long long)entry->seed,
+            entry->width, entry->height, suffix);
+    }
+
+    return result;
+}
+
+/**
+ * Maps the maze of an entry from the directory.
+ *
+ * @param cache
+ *     The cache. It must have a directory.
+ * @param entry
+ *     The entry.
+ * @return the maze, or NULL if it has not been saved
+ */
+static Maze*
+entry_map(MazeCache *cache, Entry *entry)
+{
+    char *path = entry_path(cache, entry, "");
+    MazeFileInfo info;
+    Maze *result;
+
+    if (!path) {
+        return NULL;
+    }
+    result = maze_map(path, &info);
+    free(path);
+
+    if (result && (info.generator_id != entry->generator_id
+            || info.seed != entry->seed
+            || result->width != entry->width
+            || result->height != entry->height)) {
+        maze_free(result);
+        return NULL;
+    }
+
+    return result;
+}
+
+/**
+ * Saves the maze of an entry to the directory.
+ *
+ * The maze is written to a temporary file which is then renamed, so that
+ * other processes sharing the directory never map a partial file.
+ *
+ * @param cache
+ *     The cache. It must have a directory.
+ * @param entry
+ *     The entry.
+ */
+static void
+entry_save(MazeCache *cache, Entry *entry)
+{
+    MazeFileInfo info;
+    char suffix[32];
+    char *path, *temporary;
+
+    info.generator_id = entry->generator_id;
+    info.seed = entry->seed;
+    snprintf(suffix, sizeof(suffix), ".%ld", (long)getpid());
+    path = entry_path(cache, entry, "");
+    temporary = entry_path(cache, entry, suffix);
+    if (path && temporary) {
+        if (maze_save(entry->maze, temporary, &info)) {
+            rename(temporary, path);
+        }
+        else {
+            unlink(temporary);
+        }
+    }
+
+    free(path);
+    free(temporary);
+}
+
+/**
+ * Generates the maze of an entry.
+ *
+ * @param type
+ *     The algorithm to use.
+ * @param entry
+ *     The entry.
+ * @return the maze, or NULL if memory could not be allocated or the generator
+ *     failed
+ */
+static Maze*
+entry_generate(const MazeGeneratorType *type, Entry *entry)
+{
+    MazeAllocator allocator = {entry_alloc, entry_free, NULL};
+    MazeCreateOptions create_options = {MAZE_LAYOUT_ROWS, NULL, 0};
+    MazeInitializeOptions options = {NULL, NULL, NULL};
+    MazeRandom random;
+    Maze *result;
+
+    allocator.context = entry;
+    create_options.allocator = &allocator;
+    result = maze_create_ex(entry->width, entry->height, &create_options);
+    if (!result) {
+        return NULL;
+    }
+
+    maze_random_seed(&random, entry->seed);
+    options.random = &random;
+    if (!maze_initialize(result, type, &options)) {
+        maze_free(result);
+        return NULL;
+    }
+
+    return result;
+}
+
+MazeCache*
+maze_cache_create(size_t max_bytes, const char *directory)
+{
+    MazeCache *result;
+
+    result = malloc(sizeof(MazeCache));
+    if (!result) {
+        return NULL;
+    }
+
+    result->max_bytes = max_bytes;
+    result->bytes = 0;
+    result->directory = directory ? strdup(directory) : NULL;
+    result->buckets = calloc(INITIAL_BUCKETS, sizeof(Entry*));
+    result->bucket_mask = INITIAL_BUCKETS - 1;
+    result->count = 0;
+    result->lru_first = result->lru_last = NULL;
+    result->hits = result->disk_hits = result->misses = 0;
+    result->evictions = 0;
+    if (!result->buckets || (directory && !result->directory)
+            || pthread_mutex_init(&result->lock, NULL) != 0) {
+        free(result->buckets);
+        free(result->directory);
+        free(result);
+        return NULL;
+    }
+    if (pthread_cond_init(&result->completed, NULL) != 0) {
+        pthread_mutex_destroy(&result->lock);
+        free(result->buckets);
+        free(result->directory);
+        free(result);
+        return NULL;
+    }
+
+    return result;
+}
+
+void
+maze_cache_free(MazeCache *cache)
+{
+    while (cache->lru_first) {
+        entry_remove(cache, cache->lru_first);
+    }
+    pthread_cond_destroy(&cache->completed);
+    pthread_mutex_destroy(&cache->lock);
+    free(cache->buckets);
+    free(cache->directory);
+    free(cache);
+}
+
+Maze*
+maze_cache_get(MazeCache *cache, const MazeGeneratorType *type,
+    uint64_t seed, unsigned int width, unsigned int height)
+{
+    Entry *entry;
+    Maze *maze;
+    size_t index = hash(type->id, seed, width, height);
+    int mapped;
+
+    pthread_mutex_lock(&cache->lock);
+
+    for (entry = cache->buckets[index & cache->bucket_mask];
+            entry;
+            entry = entry->hash_next) {
+        if (entry->generator_id == type->id && entry->seed == seed
+                && entry->width == width && entry->height == height) {
+            break;
+        }
+    }
+
+    if (entry) {
+        /* Another thread may still be generating the maze; the reference
+           keeps the entry alive even if that fails */
+        entry->references++;
+        while (entry->pending) {
+            pthread_cond_wait(&cache->completed, &cache->lock);
+        }
+        maze = entry->maze;
+        if (maze) {
+            lru_remove(cache, entry);
+            lru_insert(cache, entry);
+            cache->hits++;
+        }
+        else if (--entry->references == 0) {
+            free(entry);
+        }
+        pthread_mutex_unlock(&cache->lock);
+        return maze;
+    }
+
+    entry = malloc(sizeof(Entry));
+    if (!entry) {
+        pthread_mutex_unlock(&cache->lock);
+        return NULL;
+    }
+    entry->generator_id = type->id;
+    entry->seed = seed;
+    entry->width = width;
+    entry->height = height;
+    entry->maze = NULL;
+    entry->bytes = 0;
+    entry->references = 1;
+    entry->pending = 1;
+
+    /* Insert the entry before generating the maze, so that concurrent lookups
+       of the same maze wait for it instead of duplicating the work; it is
+       referenced, so it is never evicted while pending */
+    if (cache->count >= cache->bucket_mask + 1) {
+        grow(cache);
+    }
+    entry->hash_next = cache->buckets[index & cache->bucket_mask];
+    cache->buckets[index & cache->bucket_mask] = entry;
+    lru_insert(cache, entry);
+    cache->count++;
+
+    /* Prefer a saved maze to generating it again; the lock is not held while
+       doing either, so that other lookups are not blocked, and a maze is only
+       saved once it has been generated successfully */
+    pthread_mutex_unlock(&cache->lock);
+    maze = cache->directory ? entry_map(cache, entry) : NULL;
+    mapped = maze != NULL;
+    if (maze) {
+        maze->allocator.alloc = entry_alloc;
+        maze->allocator.free = entry_free;
+        maze->allocator.context = entry;
+    }
+    else {
+        maze = entry_generate(type, entry);
+        if (maze && cache->directory) {
+            entry->maze = maze;
+            entry_save(cache, entry);
+        }
+    }
+    pthread_mutex_lock(&cache->lock);
+
+    entry->maze = maze;
+    entry->pending = 0;
+    pthread_cond_broadcast(&cache->completed);
+
+    if (!maze) {
+        /* Waiting lookups fail as well, and the last of them frees the
+           entry */
+        entry_unlink(cache, entry);
+        if (--entry->references == 0) {
+            free(entry);
+        }
+        pthread_mutex_unlock(&cache->lock);
+        return NULL;
+    }
+
+    if (mapped) {
+        cache->disk_hits++;
+    }
+    else {
+        cache->misses++;
+    }
+    entry->bytes = sizeof(Entry) + sizeof(Maze) + maze->walls_size;
+    cache->bytes += entry->bytes;
+    evict(cache);
+
+    pthread_mutex_unlock(&cache->lock);
+
+    return maze;
+}
+
+void
+maze_cache_release(MazeCache *cache, Maze *maze)
+{
+    Entry *entry = maze->allocator.context;
+
+    pthread_mutex_lock(&cache->lock);
+    entry->references--;
+    if (entry->references == 0) {
+        evict(cache);
+    }
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void
+maze_cache_stats(MazeCache *cache, MazeCacheStats *stats)
+{
+    pthread_mutex_lock(&cache->lock);
+    stats->hits = cache->hits;
+    stats->disk_hits = cache->disk_hits;
+    stats->misses = cache->misses;
+    stats->evictions = cache->evictions;
+    stats->count = cache->count;
+    stats->bytes = cache->bytes;
+    pthread_mutex_unlock(&cache->lock);
+}
@@ -0,0 +1,684 @@
+#include <string.h>
+
+#include "maze-codec.h"
+
+/**
+ * The size of the buffer for encoded data.
+ */
+#define BUFFER_SIZE 4096
+
+/**
+ * The number of bits of a probability, and the probability 1.
+ */
+#define PROBABILITY_BITS 11
+#define PROBABILITY_ONE (1 << PROBABILITY_BITS)
+
+/**
+ * How fast probabilities adapt; a probability moves 1/32 of the way towards
+ * every coded bit.
+ */
+#define ADAPT_SHIFT 5
+
+/**
+ * The range is renormalised when it falls below this value.
+ */
+#define RANGE_TOP ((uint32_t)1 << 24)
+
+/**
+ * The magic bytes at the start of a stream.
+ */
+static const unsigned char MAGIC[4] = {'M', 'A', 'Z', 'C'};
+
+/**
+ * The contexts used to predict doors.
+ *
+ * Doors leading out of the maze have a context each. The right door of a room
+ * is predicted from its left and top doors, the bottom door of the room to the
+ * left, the top door of the room to the right and the right door of the room
+ * above; the bottom door of a room is predicted from its left, top and right
+ * doors, the bottom door of the room to the left and the top door of the room
+ * to the right.
+ */
+enum {
+    CONTEXT_UP = 0,
+    CONTEXT_LEFT = 1,
+    CONTEXT_RIGHT = 2,
+    CONTEXT_DOWN = 3,
+    CONTEXT_INNER_RIGHT = 4,
+    CONTEXT_INNER_DOWN = CONTEXT_INNER_RIGHT + 32,
+    CONTEXT_COUNT = CONTEXT_INNER_DOWN + 32
+};
+
+struct MazeEncoder {
+    /** The dimensions of the maze */
+    unsigned int width, height;
+
+    /** The MAZE_CODEC_* flags */
+    unsigned int flags;
+
+    /** The next row to encode */
+    unsigned int y;
+
+    /** The function used to write data and its context */
+    MazeCodecWrite write;
+    void *context;
+
+    /** Whether all writes have succeeded */
+    int ok;
+
+    /** The doors of the previous row, one byte per room with the bottom door
+        in bit 0 and the right door in bit 1 */
+    unsigned char *above;
+
+    /** The probability that a door is closed for every context */
+    uint16_t probabilities[CONTEXT_COUNT];
+
+    /** The state of the range coder; cache is the last byte not yet written,
+        followed by cache_size - 1 bytes of 0xff */
+    uint64_t low;
+    uint32_t range;
+    unsigned char cache;
+    uint64_t cache_size;
+
+    /** The bits not yet written when storing one bit per door */
+    uint64_t bits;
+    unsigned int count;
+
+    /** The data not yet written */
+    unsigned char buffer[BUFFER_SIZE];
+    size_t used;
+};
+
+struct MazeDecoder {
+    /** The dimensions of the maze */
+    unsigned int width, height;
+
+    /** The MAZE_CODEC_* flags */
+    unsigned int flags;
+
+    /** The next row to decode */
+    unsigned int y;
+
+    /** The function used to read data and its context */
+    MazeCodecRead read;
+    void *context;
+
+    /** Whether the stream ended early */
+    int truncated;
+
+    /** The doors of the previous row, one byte per room with the bottom door
+        in bit 0 and the right door in bit 1 */
+    unsigned char *above;
+
+    /** The probability that a door is closed for every context */
+    uint16_t probabilities[CONTEXT_COUNT];
+
+    /** The state of the range decoder */
+    uint32_t range, code;
+
+    /** The bits not yet decoded when storing one bit per door */
+    unsigned int bits, count;
+
+    /** The data read but not yet decoded */
+    unsigned char buffer[BUFFER_SIZE];
+    size_t position, end;
+};
+
+/**
+ * Writes the buffered data of an encoder.
+ *
+ * @param encoder
+ *     The encoder.
+ */
+static void
+flush(MazeEncoder *encoder)
+{
+    if (encoder->ok && encoder->used > 0) {
+        encoder->ok = encoder->write(encoder->context, encoder->buffer,
+            encoder->used);
+    }
+    encoder->used = 0;
+}
+
+/**
+ * Appends a byte to the output of an encoder.
+ *
+ * @param encoder
+ *     The encoder.
+ * @param byte
+ *     The byte to write.
+ */
+static inline void
+output(MazeEncoder *encoder, unsigned char byte)
+{
+    if (encoder->used == BUFFER_SIZE) {
+        flush(encoder);
+    }
+    encoder->buffer[encoder->used++] = byte;
+}
+
+/**
+ * Moves the top byte of low out of the range coder.
+ *
+ * A byte of 0xff may still change if a carry occurs, so runs of them are
+ * counted in cache_size and written once the carry is known.
+ *
+ * @param encoder
+ *     The encoder.
+ */
+static void
+shift_low(MazeEncoder *encoder)
+{
+    if ((uint32_t)encoder->low < 0xff000000u || (encoder->low >> 32) != 0) {
+        unsigned char carry = (unsigned char)(encoder->low >> 32);
+        unsigned char byte = encoder->cache;
+
+        do {
+            output(encoder, byte + carry);
+            byte = 0xff;
+        } while (--encoder->cache_size != 0);
+        encoder->cache = (unsigned char)(encoder->low >> 24);
+    }
+    encoder->cache_size++;
+    encoder->low = (encoder->low & 0x00ffffff) << 8;
+}
+
+/**
+ * Encodes a door.
+ *
+ * @param encoder
+ *     The encoder.
+ * @param context
+ *     One of the CONTEXT_* values.
+ * @param bit
+ *     1 if the door is open, otherwise 0.
+ * @param range
+ *     Whether to use the range coder; this is a constant in every caller, so
+ *     that each row loop is compiled for one representation.
+ */
+static inline void
+encode_bit(MazeEncoder *encoder, unsigned int context, unsigned int bit,
+    int range)
+{
+    if (range) {
+        uint16_t *probability = &encoder->probabilities[context];
+        uint32_t bound = (encoder->range >> PROBABILITY_BITS) * *probability;
+
+        if (bit) {
+            encoder->low += bound;
+            encoder->range -= bound;
+            *probability -= *probability >> ADAPT_SHIFT;
+        }
+        else {
+            encoder->range = bound;
+            *probability += (PROBABILITY_ONE - *probability) >> ADAPT_SHIFT;
+        }
+        while (encoder->range < RANGE_TOP) {
+            encoder->range <<= 8;
+            shift_low(encoder);
+        }
+    }
+    else {
+        encoder->bits |= (uint64_t)bit << encoder->count;
+        if (++encoder->count == 64) {
+            unsigned int i;
+
+            for (i = 0; i < 64; i += 8) {
+                output(encoder, (unsigned char)(encoder->bits >> i));
+            }
+            encoder->bits = 0;
+            encoder->count = 0;
+        }
+    }
+}
+
+/**
+ * Reads the next byte of a stream.
+ *
+ * @param decoder
+ *     The decoder.
+ * @return the byte, or 0 if the stream has ended
+ */
+static inline unsigned char
+input(MazeDecoder *decoder)
+{
+    if (decoder->position == decoder->end) {
+        decoder->position = 0;
+        decoder->end = decoder->read(decoder->context, decoder->buffer,
+            BUFFER_SIZE);
+        if (decoder->end == 0) {
+            decoder->truncated = 1;
+            return 0;
+        }
+    }
+
+    return decoder->buffer[decoder->position++];
+}
+
+/**
+ * Decodes a door.
+ *
+ * @param decoder
+ *     The decoder.
+ * @param context
+ *     One of the CONTEXT_* values.
+ * @param range
+ *     Whether to use the range decoder.
+ * @return 1 if the door is open, otherwise 0
+ */
+static inline unsigned int
+decode_bit(MazeDecoder *decoder, unsigned int context, int range)
+{
+    unsigned int bit;
+
+    if (range) {
+        uint16_t *probability = &decoder->probabilities[context];
+        uint32_t bound = (decoder->range >> PROBABILITY_BITS) * *probability;
+
+        if (decoder->code >= bound) {
+            decoder->code -= bound;
+            decoder->range -= bound;
+            *probability -= *probability >> ADAPT_SHIFT;
+            bit = 1;
+        }
+        else {
+            decoder->range = bound;
+            *probability += (PROBABILITY_ONE - *probability) >> ADAPT_SHIFT;
+            bit = 0;
+        }
+        while (decoder->range < RANGE_TOP) {
+            decoder->range <<= 8;
+            decoder->code = (decoder->code << 8) | input(decoder);
+        }
+    }
+    else {
+        if (decoder->count == 0) {
+            decoder->bits = input(decoder);
+            decoder->count = 8;
+        }
+        bit = decoder->bits & 1;
+        decoder->bits >>= 1;
+        decoder->count--;
+    }
+
+    return bit;
+}
+
+MazeEncoder*
+maze_encoder_create(unsigned int width, unsigned int height,
+    unsigned int flags, MazeCodecWrite write, void *context)
+{
+    MazeEncoder *result;
+    size_t size, i;
+
+    if (!maze_walls_size(width, height, MAZE_LAYOUT_ROWS, &size)) {
+        return NULL;
+    }
+
+    result = malloc(sizeof(MazeEncoder));
+    if (!result) {
+        return NULL;
+    }
+    result->above = malloc(width ? width : 1);
+    if (!result->above) {
+        free(result);
+        return NULL;
+    }
+
+    result->width = width;
+    result->height = height;
+    result->flags = flags & MAZE_CODEC_RANGE;
+    result->y = 0;
+    result->write = write;
+    result->context = context;
+    result->ok = 1;
+    for (i = 0; i < CONTEXT_COUNT; i++) {
+        result->probabilities[i] = PROBABILITY_ONE / 2;
+    }
+    result->low = 0;
+    result->range = 0xffffffffu;
+    result->cache = 0;
+    result->cache_size = 1;
+    result->bits = 0;
+    result->count = 0;
+    result->used = 0;
+
+    memcpy(result->buffer, MAGIC, sizeof(MAGIC));
+    result->buffer[4] = MAZE_CODEC_VERSION;
+    result->buffer[5] = (unsigned char)result->flags;
+    result->buffer[6] = result->buffer[7] = 0;
+    for (i = 0; i < 4; i++) {
+        result->buffer[8 + i] = (unsigned char)(width >> (8 * i));
+        result->buffer[12 + i] = (unsigned char)(height >> (8 * i));
+    }
+    result->used = MAZE_CODEC_HEADER_SIZE;
+    flush(result);
+    if (!result->ok) {
+        maze_encoder_free(result);
+        return NULL;
+    }
+
+    return result;
+}
+
+/**
+ * Encodes the next row of a maze.
+ *
+ * @param encoder
+ *     The encoder.
+ * @param walls
+ *     The room values of the row.
+ * @param range
+ *     Whether to use the range coder.
+ */
+static inline void
+encode_row(MazeEncoder *encoder, const unsigned char *walls, int range)
+{
+    unsigned char *above = encoder->above;
+    unsigned int width = encoder->width;
+    int last = encoder->y == encoder->height - 1;
+    unsigned int x, left, down_left = 0;
+
+    if (encoder->y == 0) {
+        for (x = 0; x < width; x++) {
+            above[x] = (walls[x] & MAZE_WALL_UP) != 0;
+            encode_bit(encoder, CONTEXT_UP, above[x], range);
+        }
+    }
+
+    left = (walls[0] & MAZE_WALL_LEFT) != 0;
+    encode_bit(encoder, CONTEXT_LEFT, left, range);
+    for (x = 0; x < width; x++) {
+        unsigned int up = above[x] & 1;
+        unsigned int right = (walls[x] & MAZE_WALL_RIGHT) != 0;
+        unsigned int down = (walls[x] & MAZE_WALL_DOWN) != 0;
+
+        if (x == width - 1) {
+            encode_bit(encoder, CONTEXT_RIGHT, right, range);
+        }
+        else {
+            encode_bit(encoder, CONTEXT_INNER_RIGHT
+                + (left | up << 1 | down_left << 2 | (above[x + 1] & 1) << 3
+                    | (above[x] >> 1) << 4),
+                right, range);
+        }
+        if (last) {
+            encode_bit(encoder, CONTEXT_DOWN, down, range);
+        }
+        else {
+            encode_bit(encoder, CONTEXT_INNER_DOWN
+                + (left | up << 1 | right << 2 | down_left << 3
+                    | (x + 1 < width ? above[x + 1] & 1 : 0) << 4),
+                down, range);
+        }
+
+        above[x] = down | right << 1;
+        left = right;
+        down_left = down;
+    }
+}
+
+int
+maze_encoder_row(MazeEncoder *encoder, const unsigned char *walls)
+{
+    if (encoder->y >= encoder->height || !encoder->ok) {
+        return 0;
+    }
+
+    if (encoder->width > 0) {
+        if (encoder->flags & MAZE_CODEC_RANGE) {
+            encode_row(encoder, walls, 1);
+        }
+        else {
+            encode_row(encoder, walls, 0);
+        }
+    }
+    encoder->y++;
+
+    return encoder->ok;
+}
+
+int
+maze_encoder_finish(MazeEncoder *encoder)
+{
+    unsigned int i;
+
+    if (encoder->flags & MAZE_CODEC_RANGE) {
+        for (i = 0; i < 5; i++) {
+            shift_low(encoder);
+        }
+    }
+    else {
+        for (i = 0; i < encoder->count; i += 8) {
+            output(encoder, (unsigned char)(encoder->bits >> i));
+        }
+        encoder->bits = 0;
+        encoder->count = 0;
+    }
+    flush(encoder);
+
+    return encoder->ok && encoder->y == encoder->height;
+}
+
+void
+maze_encoder_free(MazeEncoder *encoder)
+{
+    free(encoder->above);
+    free(encoder);
+}
+
+MazeDecoder*
+maze_decoder_create(MazeCodecRead read, void *context, unsigned int *width,
+    unsigned int *height)
+{
+    MazeDecoder *result;
+    unsigned char header[MAZE_CODEC_HEADER_SIZE];
+    size_t size, i;
+
+    result = malloc(sizeof(MazeDecoder));
+    if (!result) {
+        return NULL;
+    }
+    result->read = read;
+    result->context = context;
+    result->truncated = 0;
+    result->above = NULL;
+    result->position = result->end = 0;
+
+    for (i = 0; i < sizeof(header); i++) {
+        header[i] = input(result);
+    }
+    result->width = result->height = 0;
+    for (i = 0; i < 4; i++) {
+        result->width |= (unsigned int)header[8 + i] << (8 * i);
+        result->height |= (unsigned int)header[12 + i] << (8 * i);
+    }
+    result->flags = header[5];
+    if (result->truncated || memcmp(header, MAGIC, sizeof(MAGIC)) != 0
+            || header[4] != MAZE_CODEC_VERSION
+            || (result->flags & ~MAZE_CODEC_RANGE) != 0
+            || !maze_walls_size(result->width, result->height,
+                MAZE_LAYOUT_ROWS, &size)) {
+        maze_decoder_free(result);
+        return NULL;
+    }
+
+    result->above = malloc(result->width ? result->width : 1);
+    if (!result->above) {
+        maze_decoder_free(result);
+        return NULL;
+    }
+
+    result->y = 0;
+    for (i = 0; i < CONTEXT_COUNT; i++) {
+        result->probabilities[i] = PROBABILITY_ONE / 2;
+    }
+    result->range = 0xffffffffu;
+    result->code = 0;
+    result->bits = 0;
+    result->count = 0;
+    if (result->flags & MAZE_CODEC_RANGE) {
+        for (i = 0; i < 5; i++) {
+            result->code = (result->code << 8) | input(result);
+        }
+    }
+
+    *width = result->width;
+    *height = result->height;
+
+    return result;
+}
+
+/**
+ * Decodes the next row of a maze.
+ *
+ * @param decoder
+ *     The decoder.
+ * @param walls
+ *     Receives the room values of the row.
+ * @param range
+ *     Whether to use the range decoder.
+ */
+static inline void
+decode_row(MazeDecoder *decoder, unsigned char *walls, int range)
+{
+    unsigned char *above = decoder->above;
+    unsigned int width = decoder->width;
+    int last = decoder->y == decoder->height - 1;
+    unsigned int x, left, down_left = 0;
+
+    if (decoder->y == 0) {
+        for (x = 0; x < width; x++) {
+            above[x] = decode_bit(decoder, CONTEXT_UP, range);
+        }
+    }
+
+    left = decode_bit(decoder, CONTEXT_LEFT, range);
+    for (x = 0; x < width; x++) {
+        unsigned int up = above[x] & 1;
+        unsigned int right, down;
+
+        if (x == width - 1) {
+            right = decode_bit(decoder, CONTEXT_RIGHT, range);
+        }
+        else {
+            right = decode_bit(decoder, CONTEXT_INNER_RIGHT
+                + (left | up << 1 | down_left << 2 | (above[x + 1] & 1) << 3
+                    | (above[x] >> 1) << 4), range);
+        }
+        if (last) {
+            down = decode_bit(decoder, CONTEXT_DOWN, range);
+        }
+        else {
+            down = decode_bit(decoder, CONTEXT_INNER_DOWN
+                + (left | up << 1 | right << 2 | down_left << 3
+                    | (x + 1 < width ? above[x + 1] & 1 : 0) << 4), range);
+        }
+
+        walls[x] = left * MAZE_WALL_LEFT | up * MAZE_WALL_UP
+            | right * MAZE_WALL_RIGHT | down * MAZE_WALL_DOWN;
+        above[x] = down | right << 1;
+        left = right;
+        down_left = down;
+    }
+}
+
+int
+maze_decoder_row(MazeDecoder *decoder, unsigned char *walls)
+{
+    if (decoder->y >= decoder->height || decoder->truncated) {
+        return 0;
+    }
+
+    if (decoder->width > 0) {
+        if (decoder->flags & MAZE_CODEC_RANGE) {
+            decode_row(decoder, walls, 1);
+        }
+        else {
+            decode_row(decoder, walls, 0);
+        }
+    }
+    decoder->y++;
+
+    return !decoder->truncated;
+}
+
+void
+maze_decoder_free(MazeDecoder *decoder)
+{
+    free(decoder->above);
+    free(decoder);
+}
+
+int
+maze_encode(Maze *maze, unsigned int flags, MazeCodecWrite write,
+    void *context)
+{
+    MazeEncoder *encoder;
+    unsigned char *buffer;
+    unsigned int y;
+    int result;
+
+    encoder = maze_encoder_create(maze->width, maze->height, flags, write,
+        context);
+    buffer = malloc(maze->width ? maze->width : 1);
+    if (!encoder || !buffer) {
+        if (encoder) {
+            maze_encoder_free(encoder);
+        }
+        free(buffer);
+        return 0;
+    }
+
+    for (y = 0; y < maze->height; y++) {
+        if (!maze_encoder_row(encoder,
+                maze_row_read(maze, 0, y, maze->width, buffer))) {
+            break;
+        }
+    }
+    result = maze_encoder_finish(encoder);
+
+    maze_encoder_free(encoder);
+    free(buffer);
+
+    return result;
+}
+
+Maze*
+maze_decode(MazeCodecRead read, void *context,
+    const MazeCreateOptions *options)
+{
+    MazeDecoder *decoder;
+    Maze *result;
+    unsigned char *buffer;
+    unsigned int width, height, y;
+
+    decoder = maze_decoder_create(read, context, &width, &height);
+    if (!decoder) {
+        return NULL;
+    }
+    result = maze_create_ex(width, height, options);
+    buffer = malloc(width ? width : 1);
+    if (!result || !buffer) {
+        maze_decoder_free(decoder);
+        maze_free(result);
+        free(buffer);
+        return NULL;
+    }
+
+    for (y = 0; y < height; y++) {
+        if (!maze_decoder_row(decoder, buffer)) {
+            maze_decoder_free(decoder);
+            maze_free(result);
+            free(buffer);
+            return NULL;
+        }
+        maze_row_merge(result, 0, y, width, buffer);
+    }
+    maze_edge_update(result);
+
+    maze_decoder_free(decoder);
+    free(buffer);
+
+    return result;
+}
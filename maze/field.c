@@ -0,0 +1,537 @@
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "maze-field.h"
+
+/**
+ * The minimum number of rooms at one distance for the level to be split
+ * between threads; waking the threads costs about as much as expanding this
+ * many rooms.
+ */
+#define PARALLEL_LEVEL 4096
+
+/**
+ * The number of rooms of a level a thread takes at a time.
+ */
+#define CHUNK 256
+
+/**
+ * The number of rooms the update queue initially holds.
+ */
+#define MIN_QUEUE 64
+
+/**
+ * The offsets of the room behind each wall, indexed by the bit of the wall.
+ */
+static const int DX[4] = {-1, 0, 1, 0};
+static const int DY[4] = {0, -1, 0, 1};
+
+/**
+ * A room of a level.
+ */
+typedef struct {
+    /** The coordinates of the room */
+    unsigned int x, y;
+} Room;
+
+/**
+ * The state shared between all threads of a search.
+ */
+typedef struct {
+    /** The maze being searched */
+    Maze *maze;
+
+    /** The fields being calculated */
+    uint32_t *distances;
+    unsigned char *directions;
+
+    /** The rooms at the current distance, and the rooms found at the next
+        distance */
+    Room *current, *next;
+    size_t current_count, next_count;
+
+    /** The current distance */
+    uint32_t level;
+
+    /** The index of the next room of the current level to take */
+    size_t cursor;
+
+    /** The worker threads; they are only started once there is a level
+        large enough to share */
+    pthread_t *handles;
+    unsigned int threads, workers;
+
+    /** The number of levels handed to the workers, the number of workers
+        still expanding the current one, and whether the workers should
+        exit */
+    pthread_mutex_t lock;
+    pthread_cond_t wake, done;
+    unsigned long generation;
+    unsigned int running;
+    int stop;
+} Search;
+
+/**
+ * Finds the doors of a room leading to other rooms of the maze.
+ *
+ * @param maze
+ *     The maze.
+ * @param x, y
+ *     The coordinates of the room. This must be within the maze.
+ * @return the open walls of the room, except those leading out of the maze
+ */
+static inline unsigned int
+doors(Maze *maze, unsigned int x, unsigned int y)
+{
+    unsigned int result = maze->walls[maze_index(maze, x, y)];
+
+    if (x == 0) {
+        result &= ~MAZE_WALL_LEFT;
+    }
+    if (y == 0) {
+        result &= ~MAZE_WALL_UP;
+    }
+    if (x == maze->width - 1) {
+        result &= ~MAZE_WALL_RIGHT;
+    }
+    if (y == maze->height - 1) {
+        result &= ~MAZE_WALL_DOWN;
+    }
+
+    return result;
+}
+
+/**
+ * Finds the index of a neighbouring room in the fields.
+ *
+ * @param maze
+ *     The maze.
+ * @param room
+ *     The index of the room.
+ * @param d
+ *     The bit of the wall leading to the neighbour.
+ * @return the index of the neighbour
+ */
+static inline size_t
+neighbour(Maze *maze, size_t room, int d)
+{
+    switch (d) {
+    case 0:
+        return room - 1;
+    case 1:
+        return room - maze->width;
+    case 2:
+        return room + 1;
+    default:
+        return room + maze->width;
+    }
+}
+
+/**
+ * Finds the first step from a room towards the target; when several doors
+ * lead closer to it, the one with the lowest bit is used.
+ *
+ * @param maze
+ *     The maze.
+ * @param distances
+ *     The distances.
+ * @param x, y
+ *     The coordinates of the room.
+ * @return the wall to pass through, or 0 for the target and unreachable rooms
+ */
+static inline unsigned char
+direction(Maze *maze, const uint32_t *distances, unsigned int x,
+    unsigned int y)
+{
+    size_t room = (size_t)y * maze->width + x;
+    uint32_t distance = distances[room];
+    unsigned int open;
+
+    if (distance == 0 || distance == MAZE_FIELD_UNREACHABLE) {
+        return 0;
+    }
+
+    for (open = doors(maze, x, y); open; open &= open - 1) {
+        int d = __builtin_ctz(open);
+
+        if (distances[neighbour(maze, room, d)] == distance - 1) {
+            return 1 << d;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Finds the rooms of the next level reachable from a room.
+ *
+ * Every door leading to a room of the next level is added to the direction
+ * of that room, so that the lowest one can be kept once all levels are done.
+ *
+ * @param search
+ *     The search.
+ * @param room
+ *     The room to expand.
+ * @param parallel
+ *     Whether other threads may claim rooms at the same time.
+ * @param found
+ *     Receives the rooms claimed; it must have room for four.
+ * @return the number of rooms claimed
+ */
+static inline size_t
+expand(Search *search, Room room, int parallel, Room *found)
+{
+    Maze *maze = search->maze;
+    uint32_t *distances = search->distances;
+    uint32_t distance = search->level + 1;
+    size_t index = (size_t)room.y * maze->width + room.x;
+    unsigned int open = doors(maze, room.x, room.y);
+    size_t count = 0;
+
+    for (; open; open &= open - 1) {
+        int d = __builtin_ctz(open);
+        size_t next = neighbour(maze, index, d);
+        uint32_t previous = parallel
+            ? __atomic_load_n(&distances[next], __ATOMIC_RELAXED)
+            : distances[next];
+
+        /* Several rooms of a level may lead to the same room, but only one
+           of them may add it to the next level */
+        if (previous == MAZE_FIELD_UNREACHABLE) {
+            if (parallel) {
+                previous = __sync_val_compare_and_swap(&distances[next],
+                    MAZE_FIELD_UNREACHABLE, distance);
+            }
+            else {
+                distances[next] = distance;
+            }
+            if (previous == MAZE_FIELD_UNREACHABLE) {
+                found[count].x = room.x + DX[d];
+                found[count].y = room.y + DY[d];
+                count++;
+            }
+        }
+
+        if (search->directions && (previous == MAZE_FIELD_UNREACHABLE
+                || previous == distance)) {
+            if (parallel) {
+                __sync_fetch_and_or(&search->directions[next],
+                    maze_wall_opposite(1 << d));
+            }
+            else {
+                search->directions[next] |= maze_wall_opposite(1 << d);
+            }
+        }
+    }
+
+    return count;
+}
+
+/**
+ * Expands all rooms of the current level into the next level.
+ *
+ * @param search
+ *     The search.
+ * @param parallel
+ *     Whether other threads expand the level at the same time.
+ */
+static void
+level_expand(Search *search, int parallel)
+{
+    Room found[4 * CHUNK];
+    size_t start, end, count, offset, i;
+
+    if (!parallel) {
+        for (i = 0; i < search->current_count; i++) {
+            search->next_count += expand(search, search->current[i], 0,
+                search->next + search->next_count);
+        }
+        return;
+    }
+
+    while ((start = __sync_fetch_and_add(&search->cursor, CHUNK))
+            < search->current_count) {
+        end = start + CHUNK < search->current_count
+            ? start + CHUNK
+            : search->current_count;
+        for (count = 0, i = start; i < end; i++) {
+            count += expand(search, search->current[i], 1, found + count);
+        }
+
+        offset = __sync_fetch_and_add(&search->next_count, count);
+        memcpy(search->next + offset, found, count * sizeof(Room));
+    }
+}
+
+/**
+ * Expands the levels handed to the workers until the search is complete.
+ *
+ * @param data
+ *     The Search.
+ * @return NULL
+ */
+static void*
+worker(void *data)
+{
+    Search *search = data;
+    unsigned long generation = 0;
+
+    for (;;) {
+        pthread_mutex_lock(&search->lock);
+        while (search->generation == generation && !search->stop) {
+            pthread_cond_wait(&search->wake, &search->lock);
+        }
+        if (search->stop) {
+            pthread_mutex_unlock(&search->lock);
+            return NULL;
+        }
+        generation = search->generation;
+        pthread_mutex_unlock(&search->lock);
+
+        level_expand(search, 1);
+
+        pthread_mutex_lock(&search->lock);
+        if (--search->running == 0) {
+            pthread_cond_signal(&search->done);
+        }
+        pthread_mutex_unlock(&search->lock);
+    }
+}
+
+/**
+ * Expands the current level on all threads of a search, starting the workers
+ * the first time. If no worker can be started, the calling thread expands the
+ * level alone.
+ *
+ * @param search
+ *     The search.
+ */
+static void
+level_expand_parallel(Search *search)
+{
+    /* The workers wait for the first level, so they must be started before
+       the generation changes */
+    if (!search->handles) {
+        search->handles = malloc(sizeof(pthread_t) * (search->threads - 1));
+        while (search->handles && search->workers < search->threads - 1
+                && pthread_create(&search->handles[search->workers], NULL,
+                    worker, search) == 0) {
+            search->workers++;
+        }
+    }
+    if (search->workers == 0) {
+        level_expand(search, 0);
+        return;
+    }
+
+    pthread_mutex_lock(&search->lock);
+    search->cursor = 0;
+    search->running = search->workers;
+    search->generation++;
+    pthread_cond_broadcast(&search->wake);
+    pthread_mutex_unlock(&search->lock);
+
+    level_expand(search, 1);
+
+    pthread_mutex_lock(&search->lock);
+    while (search->running > 0) {
+        pthread_cond_wait(&search->done, &search->lock);
+    }
+    pthread_mutex_unlock(&search->lock);
+}
+
+int
+maze_distance_field(Maze *maze, int tx, int ty, uint32_t *distances)
+{
+    return maze_flow_field(maze, tx, ty, distances, NULL, 0);
+}
+
+int
+maze_flow_field(Maze *maze, int tx, int ty, uint32_t *distances,
+    unsigned char *directions, unsigned int threads)
+{
+    Search search;
+    size_t count = (size_t)maze->width * maze->height;
+    size_t i;
+
+    if (!maze_contains(maze, tx, ty) || count > UINT32_MAX) {
+        return 0;
+    }
+
+    if (threads == 0) {
+        long processors = sysconf(_SC_NPROCESSORS_ONLN);
+
+        threads = processors > 0 ? (unsigned int)processors : 1;
+    }
+
+    /* Every room is in exactly one level, so each level fits */
+    search.maze = maze;
+    search.distances = distances;
+    search.directions = directions;
+    search.current = malloc(sizeof(Room) * count);
+    search.next = malloc(sizeof(Room) * count);
+    search.handles = NULL;
+    search.threads = threads;
+    search.workers = 0;
+    search.generation = 0;
+    search.stop = 0;
+    if (!search.current || !search.next) {
+        free(search.current);
+        free(search.next);
+        return 0;
+    }
+    pthread_mutex_init(&search.lock, NULL);
+    pthread_cond_init(&search.wake, NULL);
+    pthread_cond_init(&search.done, NULL);
+
+    for (i = 0; i < count; i++) {
+        distances[i] = MAZE_FIELD_UNREACHABLE;
+    }
+    if (directions) {
+        memset(directions, 0, count);
+    }
+    distances[(size_t)ty * maze->width + tx] = 0;
+    search.current[0].x = tx;
+    search.current[0].y = ty;
+    search.current_count = 1;
+    search.level = 0;
+
+    while (search.current_count > 0) {
+        Room *swap;
+
+        search.next_count = 0;
+        if (search.current_count >= PARALLEL_LEVEL && threads > 1) {
+            level_expand_parallel(&search);
+        }
+        else {
+            level_expand(&search, 0);
+        }
+
+        swap = search.current;
+        search.current = search.next;
+        search.next = swap;
+        search.current_count = search.next_count;
+        search.level++;
+    }
+
+    /* Every door leading closer to the target has been recorded; keep the
+       lowest one, since which room of a level reaches a room first depends
+       on the threads */
+    if (directions) {
+        for (i = 0; i < count; i++) {
+            directions[i] &= -directions[i];
+        }
+    }
+
+    pthread_mutex_lock(&search.lock);
+    search.stop = 1;
+    pthread_cond_broadcast(&search.wake);
+    pthread_mutex_unlock(&search.lock);
+    for (i = 0; i < search.workers; i++) {
+        pthread_join(search.handles[i], NULL);
+    }
+
+    pthread_mutex_destroy(&search.lock);
+    pthread_cond_destroy(&search.wake);
+    pthread_cond_destroy(&search.done);
+    free(search.handles);
+    free(search.current);
+    free(search.next);
+
+    return 1;
+}
+
+int
+maze_flow_field_update(Maze *maze, uint32_t *distances,
+    unsigned char *directions, int x, int y, unsigned char wall)
+{
+    uint32_t *queue, *larger;
+    size_t capacity = MIN_QUEUE;
+    size_t head, tail, near, far, i;
+    int nx = x, ny = y;
+
+    if (!maze_contains(maze, x, y)
+            || !maze_door_enter(maze, &nx, &ny, wall, 1)
+            || !maze_contains(maze, nx, ny)) {
+        return 1;
+    }
+
+    near = (size_t)y * maze->width + x;
+    far = (size_t)ny * maze->width + nx;
+    if (distances[far] < distances[near]) {
+        near = far;
+        far = (size_t)y * maze->width + x;
+    }
+    if (distances[near] == MAZE_FIELD_UNREACHABLE) {
+        return 1;
+    }
+
+    /* The door does not bring any room closer, but it may be a door with a
+       lower bit leading as close as before */
+    if (distances[far] <= distances[near] + 1) {
+        if (directions) {
+            directions[far] = direction(maze, distances,
+                far % maze->width, far / maze->width);
+        }
+        return 1;
+    }
+
+    queue = malloc(sizeof(uint32_t) * capacity);
+    if (!queue) {
+        return 0;
+    }
+
+    /* A breadth first search from the far room through the rooms that get
+       closer; every room is added at most once, at its final distance */
+    distances[far] = distances[near] + 1;
+    queue[0] = far;
+    for (head = 0, tail = 1; head < tail; head++) {
+        size_t room = queue[head];
+        unsigned int open = doors(maze, room % maze->width,
+            room / maze->width);
+
+        for (; open; open &= open - 1) {
+            size_t next = neighbour(maze, room, __builtin_ctz(open));
+
+            if (distances[next] <= distances[room] + 1) {
+                continue;
+            }
+
+            if (tail == capacity) {
+                larger = realloc(queue, sizeof(uint32_t) * 2 * capacity);
+                if (!larger) {
+                    free(queue);
+                    return 0;
+                }
+                queue = larger;
+                capacity *= 2;
+            }
+            distances[next] = distances[room] + 1;
+            queue[tail++] = next;
+        }
+    }
+
+    /* The rooms that got closer, and their neighbours, which may now have a
+       door with a lower bit leading as close as before */
+    if (directions) {
+        for (i = 0; i < tail; i++) {
+            size_t room = queue[i];
+            unsigned int rx = room % maze->width;
+            unsigned int ry = room / maze->width;
+            unsigned int open = doors(maze, rx, ry);
+
+            directions[room] = direction(maze, distances, rx, ry);
+            for (; open; open &= open - 1) {
+                size_t next = neighbour(maze, room, __builtin_ctz(open));
+
+                directions[next] = direction(maze, distances,
+                    next % maze->width, next / maze->width);
+            }
+        }
+    }
+
+    free(queue);
+
+    return 1;
+}
@@ -0,0 +1,159 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "maze-file.h"
+
+/**
+ * The magic bytes at the start of a file; the line endings and the end of file
+ * character detect files mangled by text mode transfers.
+ */
+static const unsigned char MAGIC[8] = {'M', 'A', 'Z', 'E', '\r', '\n', 0x1a,
+    '\n'};
+
+/**
+ * Writes a little endian number to a buffer.
+ *
+ * @param buffer
+ *     The buffer.
+ * @param value
+ *     The value to write.
+ * @param size
+ *     The number of bytes to write.
+ */
+static void
+put(unsigned char *buffer, uint64_t value, unsigned int size)
+{
+    unsigned int i;
+
+    for (i = 0; i < size; i++) {
+        buffer[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+/**
+ * Reads a little endian number from a buffer.
+ *
+ * @param buffer
+ *     The buffer.
+ * @param size
+ *     The number of bytes to read.
+ * @return the value
+ */
+static uint64_t
+get(const unsigned char *buffer, unsigned int size)
+{
+    uint64_t result = 0;
+    unsigned int i;
+
+    for (i = 0; i < size; i++) {
+        result |= (uint64_t)buffer[i] << (8 * i);
+    }
+
+    return result;
+}
+
+int
+maze_save(Maze *maze, const char *path, const MazeFileInfo *info)
+{
+    unsigned char header[MAZE_FILE_HEADER_SIZE];
+    FILE *file;
+    int result;
+
+    memset(header, 0, sizeof(header));
+    memcpy(header, MAGIC, sizeof(MAGIC));
+    put(header + 8, MAZE_FILE_VERSION, 4);
+    put(header + 12, maze->layout, 4);
+    put(header + 16, maze->width, 4);
+    put(header + 20, maze->height, 4);
+    put(header + 24, info ? info->generator_id : 0, 4);
+    put(header + 32, info ? info->seed : 0, 8);
+    put(header + 40, maze->walls_size, 8);
+
+    file = fopen(path, "wb");
+    if (!file) {
+        return 0;
+    }
+
+    result = fwrite(header, sizeof(header), 1, file) == 1
+        && fwrite(maze->walls, 1, maze->walls_size, file) == maze->walls_size;
+
+    return fclose(file) == 0 && result;
+}
+
+Maze*
+maze_map(const char *path, MazeFileInfo *info)
+{
+    unsigned char header[MAZE_FILE_HEADER_SIZE];
+    struct stat st;
+    Maze *result;
+    void *mapping;
+    uint64_t width, height, layout, walls_size;
+    size_t size;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    if (fstat(fd, &st) != 0
+            || read(fd, header, sizeof(header)) != sizeof(header)
+            || memcmp(header, MAGIC, sizeof(MAGIC)) != 0
+            || get(header + 8, 4) != MAZE_FILE_VERSION) {
+        close(fd);
+        return NULL;
+    }
+
+    /* The walls array must be exactly the size of a maze with the stored
+       dimensions, and the file must be large enough to contain it */
+    layout = get(header + 12, 4);
+    width = get(header + 16, 4);
+    height = get(header + 20, 4);
+    walls_size = get(header + 40, 8);
+    if ((layout != MAZE_LAYOUT_ROWS && layout != MAZE_LAYOUT_TILES)
+            || !maze_walls_size(width, height, layout, &size)
+            || walls_size != size
+            || (uint64_t)st.st_size < MAZE_FILE_HEADER_SIZE + walls_size
+            || size > SIZE_MAX - MAZE_FILE_HEADER_SIZE) {
+        close(fd);
+        return NULL;
+    }
+
+    /* The mapping remains valid after the file is closed */
+    mapping = mmap(NULL, MAZE_FILE_HEADER_SIZE + size, PROT_READ, MAP_SHARED,
+        fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return NULL;
+    }
+
+    result = MAZE_ALLOCATOR_MALLOC.alloc(MAZE_ALLOCATOR_MALLOC.context,
+        sizeof(Maze));
+    if (!result) {
+        munmap(mapping, MAZE_FILE_HEADER_SIZE + size);
+        return NULL;
+    }
+
+    result->width = width;
+    result->height = height;
+    result->layout = layout;
+    result->walls = (unsigned char*)mapping + MAZE_FILE_HEADER_SIZE;
+    result->data = NULL;
+    result->allocator = MAZE_ALLOCATOR_MALLOC;
+    result->walls_size = size;
+    result->mapping = mapping;
+    result->mapping_size = MAZE_FILE_HEADER_SIZE + size;
+    result->dirty = NULL;
+    result->snapshot = NULL;
+
+    if (info) {
+        info->generator_id = get(header + 24, 4);
+        info->seed = get(header + 32, 8);
+    }
+
+    return result;
+}
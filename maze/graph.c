@@ -0,0 +1,807 @@
+#include <string.h>
+
+#include "maze-graph.h"
+
+/**
+ * The number of heap entries and legs a workspace initially holds.
+ */
+#define MIN_CAPACITY 64
+
+/**
+ * The offsets of the room behind each wall, indexed by the bit of the wall.
+ */
+static const int DX[4] = {-1, 0, 1, 0};
+static const int DY[4] = {0, -1, 0, 1};
+
+/**
+ * An entry of the open set.
+ */
+typedef struct {
+    /** The length of the best known route through the node plus the
+        estimate of the remaining steps */
+    size_t cost;
+
+    /** The node */
+    uint32_t node;
+} Entry;
+
+/**
+ * The connection of a room to a node at the end of its corridor.
+ */
+typedef struct {
+    /** The node */
+    uint32_t node;
+
+    /** The number of steps from the room to the node */
+    uint32_t distance;
+
+    /** The wall through which the room is left, or 0 if it is the node */
+    unsigned char leave;
+
+    /** The wall through which the node is entered, or 0 if the room is the
+        node */
+    unsigned char enter;
+} Anchor;
+
+/**
+ * The state of a node during a search.
+ */
+typedef struct {
+    /** Twice the generation for nodes in the open set, one more for closed
+        nodes, and anything else for nodes not seen by the current search */
+    uint32_t stamp;
+
+    /** The length of the best known route to the node */
+    uint32_t cost;
+
+    /** The node and the edge the node was reached through */
+    uint32_t previous;
+    uint32_t edge;
+} Node;
+
+struct MazeGraphWorkspace {
+    /** The state of every node, and the current search */
+    Node *nodes;
+    size_t node_capacity;
+    uint32_t generation;
+
+    /** The open set, as a binary heap */
+    Entry *heap;
+    size_t heap_count, heap_capacity;
+
+    /** The legs of the last route */
+    MazeGraphLeg *legs;
+    size_t leg_capacity;
+};
+
+/**
+ * Finds the doors of a room leading to other rooms of the maze.
+ *
+ * @param maze
+ *     The maze.
+ * @param x, y
+ *     The coordinates of the room. This must be within the maze.
+ * @return the open walls of the room, except those leading out of the maze
+ */
+static inline unsigned int
+doors(Maze *maze, unsigned int x, unsigned int y)
+{
+    unsigned int result = maze->walls[maze_index(maze, x, y)];
+
+    if (x == 0) {
+        result &= ~MAZE_WALL_LEFT;
+    }
+    if (y == 0) {
+        result &= ~MAZE_WALL_UP;
+    }
+    if (x == maze->width - 1) {
+        result &= ~MAZE_WALL_RIGHT;
+    }
+    if (y == maze->height - 1) {
+        result &= ~MAZE_WALL_DOWN;
+    }
+
+    return result;
+}
+
+/**
+ * Determines whether a bit of a bit set is set.
+ */
+static inline int
+bit_get(const uint64_t *bits, size_t index)
+{
+    return (bits[index / 64] >> (index % 64)) & 1;
+}
+
+/**
+ * Sets a bit of a bit set.
+ */
+static inline void
+bit_set(uint64_t *bits, size_t index)
+{
+    bits[index / 64] |= (uint64_t)1 << (index % 64);
+}
+
+/**
+ * Finds the node of a room.
+ *
+ * @param graph
+ *     The graph.
+ * @param room
+ *     The index of the room; it must be a node.
+ * @return the index of the node
+ */
+static inline uint32_t
+node_of(MazeGraph *graph, size_t room)
+{
+    uint64_t below = ((uint64_t)1 << (room % 64)) - 1;
+
+    return graph->ranks[room / 64]
+        + __builtin_popcountll(graph->nodes[room / 64] & below);
+}
+
+/**
+ * Follows a corridor to the node at its end.
+ *
+ * @param graph
+ *     The graph, whose node bits must be complete.
+ * @param maze
+ *     The maze.
+ * @param x, y
+ *     The room to start in. These receive the coordinates of the node.
+ * @param wall
+ *     The wall to leave through. This receives the wall through which the
+ *     node is entered.
+ * @param visited
+ *     Receives a bit for every room inside the corridor. This may be NULL.
+ * @param other
+ *     The index of a room to look for.
+ * @param other_distance
+ *     Receives the number of steps to other, if it is passed and this is not
+ *     already set.
+ * @return the number of steps to the node
+ */
+static inline uint32_t
+walk(MazeGraph *graph, Maze *maze, unsigned int *x, unsigned int *y,
+    unsigned char *wall, uint64_t *visited, size_t other,
+    uint32_t *other_distance)
+{
+    uint32_t length = 0;
+
+    for (;;) {
+        size_t room;
+
+        *x += DX[__builtin_ctz(*wall)];
+        *y += DY[__builtin_ctz(*wall)];
+        length++;
+
+        room = (size_t)*y * graph->width + *x;
+        if (room == other && *other_distance == 0) {
+            *other_distance = length;
+        }
+        if (bit_get(graph->nodes, room)) {
+            return length;
+        }
+        if (visited) {
+            bit_set(visited, room);
+        }
+
+        /* A room inside a corridor has exactly one other door */
+        *wall = doors(maze, *x, *y) & ~maze_wall_opposite(*wall);
+    }
+}
+
+/**
+ * Marks the nodes of the graph, and calculates their ranks.
+ *
+ * @param graph
+ *     The graph, with its bit sets allocated and cleared.
+ * @param maze
+ *     The maze.
+ * @param visited
+ *     A cleared bit set of the rooms.
+ * @return the number of edges
+ */
+static size_t
+nodes_find(MazeGraph *graph, Maze *maze, uint64_t *visited)
+{
+    size_t count = (size_t)maze->width * maze->height;
+    size_t edge_count = 0;
+    size_t room, i;
+    unsigned int x, y;
+
+    for (room = 0, y = 0; y < maze->height; y++) {
+        for (x = 0; x < maze->width; x++, room++) {
+            if (__builtin_popcount(doors(maze, x, y)) != 2) {
+                bit_set(graph->nodes, room);
+            }
+        }
+    }
+
+    /* Mark the rooms of all corridors between nodes */
+    for (room = 0, y = 0; y < maze->height; y++) {
+        for (x = 0; x < maze->width; x++, room++) {
+            unsigned int open;
+
+            if (!bit_get(graph->nodes, room)) {
+                continue;
+            }
+            for (open = doors(maze, x, y); open; open &= open - 1) {
+                unsigned int nx = x, ny = y;
+                unsigned char wall = open & -open;
+                uint32_t ignored = 1;
+
+                walk(graph, maze, &nx, &ny, &wall, visited, count, &ignored);
+                edge_count++;
+            }
+        }
+    }
+
+    /* Any room left is on a loop without nodes; make it a node, and mark
+       the rest of the loop */
+    for (room = 0, y = 0; y < maze->height; y++) {
+        for (x = 0; x < maze->width; x++, room++) {
+            unsigned int nx = x, ny = y;
+            unsigned char wall;
+            uint32_t ignored = 1;
+
+            if (bit_get(graph->nodes, room) || bit_get(visited, room)) {
+                continue;
+            }
+            bit_set(graph->nodes, room);
+            wall = doors(maze, x, y) & -doors(maze, x, y);
+            walk(graph, maze, &nx, &ny, &wall, visited, count, &ignored);
+            edge_count += 2;
+        }
+    }
+
+    for (graph->node_count = 0, i = 0; i < (count + 63) / 64; i++) {
+        graph->ranks[i] = graph->node_count;
+        graph->node_count += __builtin_popcountll(graph->nodes[i]);
+    }
+
+    return edge_count;
+}
+
+/**
+ * Records the nodes and the edges of the graph.
+ *
+ * @param graph
+ *     The graph, with its nodes marked and its arrays allocated.
+ * @param maze
+ *     The maze.
+ */
+static void
+edges_find(MazeGraph *graph, Maze *maze)
+{
+    size_t count = (size_t)maze->width * maze->height;
+    uint32_t node = 0, edge = 0;
+    size_t room;
+    unsigned int x, y;
+
+    for (room = 0, y = 0; y < maze->height; y++) {
+        for (x = 0; x < maze->width; x++, room++) {
+            unsigned int open;
+
+            if (!bit_get(graph->nodes, room)) {
+                continue;
+            }
+
+            graph->rooms[node] = room;
+            graph->offsets[node++] = edge;
+            for (open = doors(maze, x, y); open; open &= open - 1) {
+                unsigned int nx = x, ny = y;
+                unsigned char wall = open & -open;
+                uint32_t ignored = 1;
+
+                graph->walls[edge] = wall;
+                graph->lengths[edge] = walk(graph, maze, &nx, &ny, &wall,
+                    NULL, count, &ignored);
+                graph->targets[edge++] = node_of(graph,
+                    (size_t)ny * graph->width + nx);
+            }
+        }
+    }
+    graph->offsets[node] = edge;
+}
+
+MazeGraph*
+maze_graph_create(Maze *maze)
+{
+    MazeGraph *result;
+    size_t count = (size_t)maze->width * maze->height;
+    size_t words = (count + 63) / 64;
+    size_t edge_count;
+    uint64_t *visited;
+
+    if (count == 0 || count >= UINT32_MAX) {
+        return NULL;
+    }
+
+    result = malloc(sizeof(MazeGraph));
+    if (!result) {
+        return NULL;
+    }
+    result->width = maze->width;
+    result->height = maze->height;
+    result->rooms = NULL;
+    result->offsets = NULL;
+    result->targets = NULL;
+    result->lengths = NULL;
+    result->walls = NULL;
+    result->nodes = calloc(words, sizeof(uint64_t));
+    result->ranks = malloc(sizeof(uint32_t) * words);
+    visited = calloc(words, sizeof(uint64_t));
+    if (!result->nodes || !result->ranks || !visited) {
+        free(visited);
+        maze_graph_free(result);
+        return NULL;
+    }
+
+    edge_count = nodes_find(result, maze, visited);
+    free(visited);
+
+    result->rooms = malloc(sizeof(uint32_t) * result->node_count);
+    result->offsets = malloc(sizeof(uint32_t) * (result->node_count + 1));
+    result->targets = malloc(sizeof(uint32_t) * (edge_count + 1));
+    result->lengths = malloc(sizeof(uint32_t) * (edge_count + 1));
+    result->walls = malloc(edge_count + 1);
+    if (!result->rooms || !result->offsets || !result->targets
+            || !result->lengths || !result->walls) {
+        maze_graph_free(result);
+        return NULL;
+    }
+    edges_find(result, maze);
+
+    return result;
+}
+
+void
+maze_graph_free(MazeGraph *graph)
+{
+    free(graph->rooms);
+    free(graph->offsets);
+    free(graph->targets);
+    free(graph->lengths);
+    free(graph->walls);
+    free(graph->nodes);
+    free(graph->ranks);
+    free(graph);
+}
+
+uint32_t
+maze_graph_node_find(MazeGraph *graph, int x, int y)
+{
+    size_t room = (size_t)y * graph->width + x;
+
+    return bit_get(graph->nodes, room)
+        ? node_of(graph, room)
+        : MAZE_GRAPH_NONE;
+}
+
+MazeGraphWorkspace*
+maze_graph_workspace_create(void)
+{
+    MazeGraphWorkspace *result;
+
+    result = malloc(sizeof(MazeGraphWorkspace));
+    if (!result) {
+        return NULL;
+    }
+    result->nodes = NULL;
+    result->generation = 0;
+    result->node_capacity = 0;
+    result->heap = NULL;
+    result->heap_count = 0;
+    result->heap_capacity = 0;
+    result->legs = NULL;
+    result->leg_capacity = 0;
+
+    return result;
+}
+
+void
+maze_graph_workspace_free(MazeGraphWorkspace *workspace)
+{
+    free(workspace->nodes);
+    free(workspace->heap);
+    free(workspace->legs);
+    free(workspace);
+}
+
+/**
+ * Grows a workspace to fit a graph, and starts a new search.
+ *
+ * @param workspace
+ *     The workspace.
+ * @param graph
+ *     The graph.
+ * @return non-zero unless memory could not be allocated
+ */
+static int
+workspace_prepare(MazeGraphWorkspace *workspace, MazeGraph *graph)
+{
+    size_t count = graph->node_count;
+
+    /* The stamps of the previous searches are forgotten when the array is
+       replaced, or when the generation would wrap around */
+    if (workspace->node_capacity < count
+            || workspace->generation >= UINT32_MAX / 2 - 1) {
+        size_t capacity = count > workspace->node_capacity
+            ? count
+            : workspace->node_capacity;
+
+        free(workspace->nodes);
+        workspace->nodes = calloc(capacity, sizeof(Node));
+        workspace->generation = 0;
+        workspace->node_capacity = capacity;
+        if (!workspace->nodes) {
+            workspace->node_capacity = 0;
+            return 0;
+        }
+    }
+
+    if (!workspace->heap) {
+        workspace->heap = malloc(sizeof(Entry) * MIN_CAPACITY);
+        workspace->heap_capacity = workspace->heap ? MIN_CAPACITY : 0;
+    }
+    workspace->heap_count = 0;
+    workspace->generation++;
+
+    return workspace->heap != NULL;
+}
+
+/**
+ * Adds a node to the open set.
+ *
+ * @param workspace
+ *     The workspace.
+ * @param cost
+ *     The cost of the node.
+ * @param node
+ *     The node.
+ * @return non-zero unless memory could not be allocated
+ */
+static int
+heap_push(MazeGraphWorkspace *workspace, size_t cost, uint32_t node)
+{
+    Entry *heap = workspace->heap;
+    size_t i = workspace->heap_count;
+
+    if (i == workspace->heap_capacity) {
+        heap = realloc(heap, sizeof(Entry) * 2 * workspace->heap_capacity);
+        if (!heap) {
+            return 0;
+        }
+        workspace->heap = heap;
+        workspace->heap_capacity *= 2;
+    }
+
+    for (; i > 0 && heap[(i - 1) / 2].cost > cost; i = (i - 1) / 2) {
+        heap[i] = heap[(i - 1) / 2];
+    }
+    heap[i].cost = cost;
+    heap[i].node = node;
+    workspace->heap_count++;
+
+    return 1;
+}
+
+/**
+ * Removes the node with the lowest cost from the open set.
+ *
+ * @param workspace
+ *     The workspace. The open set must not be empty.
+ * @return the entry removed
+ */
+static Entry
+heap_pop(MazeGraphWorkspace *workspace)
+{
+    Entry *heap = workspace->heap;
+    Entry result = heap[0];
+    Entry last = heap[--workspace->heap_count];
+    size_t count = workspace->heap_count;
+    size_t i = 0;
+
+    for (;;) {
+        size_t child = 2 * i + 1;
+
+        if (child >= count) {
+            break;
+        }
+        if (child + 1 < count && heap[child + 1].cost < heap[child].cost) {
+            child++;
+        }
+        if (heap[child].cost >= last.cost) {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = last;
+
+    return result;
+}
+
+/**
+ * Estimates the number of steps from a node to a room; this is the Manhattan
+ * distance, which is never more than the actual number of steps.
+ *
+ * @param graph
+ *     The graph.
+ * @param node
+ *     The node.
+ * @param x, y
+ *     The coordinates of the room.
+ * @return the estimate
+ */
+static inline size_t
+estimate(MazeGraph *graph, uint32_t node, int x, int y)
+{
+    int nx = graph->rooms[node] % graph->width;
+    int ny = graph->rooms[node] / graph->width;
+
+    return (size_t)abs(nx - x) + (size_t)abs(ny - y);
+}
+
+/**
+ * Connects a room to the nodes at the ends of its corridor.
+ *
+ * @param graph
+ *     The graph.
+ * @param maze
+ *     The maze.
+ * @param x, y
+ *     The coordinates of the room.
+ * @param anchors
+ *     Receives the nodes.
+ * @param other
+ *     The index of a room to look for.
+ * @param direct
+ *     Receives the leg to other if it lies in the same corridor. Its length
+ *     must be 0.
+ * @return the number of anchors
+ */
+static size_t
+anchors_find(MazeGraph *graph, Maze *maze, unsigned int x, unsigned int y,
+    Anchor *anchors, size_t other, MazeGraphLeg *direct)
+{
+    size_t room = (size_t)y * graph->width + x;
+    unsigned int open;
+    size_t count = 0;
+
+    if (bit_get(graph->nodes, room)) {
+        anchors[0].node = node_of(graph, room);
+        anchors[0].distance = 0;
+        anchors[0].leave = 0;
+        anchors[0].enter = 0;
+        return 1;
+    }
+
+    for (open = doors(maze, x, y); open; open &= open - 1, count++) {
+        unsigned int nx = x, ny = y;
+        unsigned char wall = open & -open;
+
+        anchors[count].leave = wall;
+        anchors[count].distance = walk(graph, maze, &nx, &ny, &wall, NULL,
+            other, &direct->length);
+        anchors[count].node = node_of(graph, (size_t)ny * graph->width + nx);
+        anchors[count].enter = wall;
+        if (direct->length && !direct->wall) {
+            direct->wall = anchors[count].leave;
+        }
+    }
+
+    return count;
+}
+
+/**
+ * Reserves room for the legs of a route.
+ *
+ * @param workspace
+ *     The workspace.
+ * @param count
+ *     The number of legs.
+ * @return non-zero unless memory could not be allocated
+ */
+static int
+legs_reserve(MazeGraphWorkspace *workspace, size_t count)
+{
+    size_t capacity = workspace->leg_capacity ? workspace->leg_capacity
+        : MIN_CAPACITY;
+    MazeGraphLeg *legs;
+
+    if (workspace->leg_capacity >= count) {
+        return 1;
+    }
+
+    while (capacity < count) {
+        capacity *= 2;
+    }
+    legs = realloc(workspace->legs, sizeof(MazeGraphLeg) * capacity);
+    if (!legs) {
+        return 0;
+    }
+    workspace->legs = legs;
+    workspace->leg_capacity = capacity;
+
+    return 1;
+}
+
+int
+maze_graph_solve(MazeGraph *graph, Maze *maze, int sx, int sy, int tx, int ty,
+    MazeGraphWorkspace *workspace, MazeGraphRoute *route)
+{
+    Anchor starts[2], targets[2], *end = NULL;
+    MazeGraphLeg direct = {0, 0}, ignored = {0, 0};
+    size_t start_count, target_count, best, legs, i;
+    Node *nodes;
+    uint32_t open, closed, node;
+
+    route->length = 0;
+    route->leg_count = 0;
+    route->legs = NULL;
+    if (sx == tx && sy == ty) {
+        return 1;
+    }
+    if (!workspace_prepare(workspace, graph)) {
+        return 0;
+    }
+    nodes = workspace->nodes;
+    open = 2 * workspace->generation;
+    closed = open + 1;
+
+    start_count = anchors_find(graph, maze, sx, sy, starts,
+        (size_t)ty * graph->width + tx, &direct);
+    target_count = anchors_find(graph, maze, tx, ty, targets,
+        (size_t)sy * graph->width + sx, &ignored);
+    best = direct.length ? direct.length : SIZE_MAX;
+
+    for (i = 0; i < start_count; i++) {
+        node = starts[i].node;
+        if (nodes[node].stamp == open
+                && nodes[node].cost <= starts[i].distance) {
+            continue;
+        }
+        nodes[node].stamp = open;
+        nodes[node].cost = starts[i].distance;
+        nodes[node].previous = MAZE_GRAPH_NONE;
+        if (!heap_push(workspace, starts[i].distance
+                + estimate(graph, node, tx, ty), node)) {
+            return 0;
+        }
+    }
+
+    /* A* search; no corridor is shorter than the Manhattan distance between
+       its ends, so the estimate is consistent and no node is closed too
+       early */
+    while (workspace->heap_count > 0) {
+        Entry entry = heap_pop(workspace);
+        uint32_t e;
+
+        node = entry.node;
+        if (nodes[node].stamp == closed) {
+            continue;
+        }
+        if (entry.cost >= best) {
+            break;
+        }
+        nodes[node].stamp = closed;
+
+        for (i = 0; i < target_count; i++) {
+            if (targets[i].node == node
+                    && (size_t)nodes[node].cost + targets[i].distance < best) {
+                best = (size_t)nodes[node].cost + targets[i].distance;
+                end = &targets[i];
+            }
+        }
+
+        for (e = graph->offsets[node]; e < graph->offsets[node + 1]; e++) {
+            uint32_t next = graph->targets[e];
+            uint32_t cost = nodes[node].cost + graph->lengths[e];
+
+            if (nodes[next].stamp == closed || (nodes[next].stamp == open
+                    && nodes[next].cost <= cost)) {
+                continue;
+            }
+
+            /* A route never passes through a dead end, so only the dead
+               ends of the last room are worth visiting */
+            if (graph->offsets[next + 1] - graph->offsets[next] == 1
+                    && next != targets[0].node
+                    && next != targets[target_count - 1].node) {
+                continue;
+            }
+
+            nodes[next].stamp = open;
+            nodes[next].cost = cost;
+            nodes[next].previous = node;
+            nodes[next].edge = e;
+            if (!heap_push(workspace, cost + estimate(graph, next, tx, ty),
+                    next)) {
+                return 0;
+            }
+        }
+    }
+
+    if (best == SIZE_MAX) {
+        return 0;
+    }
+    route->length = best;
+
+    /* The rooms lie in the same corridor, and going through a node is no
+       shorter */
+    if (!end) {
+        if (!legs_reserve(workspace, 1)) {
+            return 0;
+        }
+        workspace->legs[0] = direct;
+        route->leg_count = 1;
+        route->legs = workspace->legs;
+        return 1;
+    }
+
+    /* Count the edges back to the first node, and then record them */
+    for (legs = 2, node = end->node; nodes[node].previous != MAZE_GRAPH_NONE;
+            node = nodes[node].previous) {
+        legs++;
+    }
+    if (!legs_reserve(workspace, legs)) {
+        return 0;
+    }
+    workspace->legs[legs - 1].wall = end->enter
+        ? maze_wall_opposite(end->enter)
+        : 0;
+    workspace->legs[legs - 1].length = end->distance;
+    for (i = legs - 1, node = end->node; nodes[node].previous
+            != MAZE_GRAPH_NONE; node = nodes[node].previous) {
+        uint32_t e = nodes[node].edge;
+
+        i--;
+        workspace->legs[i].wall = graph->walls[e];
+        workspace->legs[i].length = graph->lengths[e];
+    }
+    for (i = 0; i < start_count; i++) {
+        if (starts[i].node == node && starts[i].distance == nodes[node].cost) {
+            workspace->legs[0].wall = starts[i].leave;
+            workspace->legs[0].length = starts[i].distance;
+            break;
+        }
+    }
+
+    /* Skip the legs of rooms that are nodes themselves */
+    route->legs = workspace->legs;
+    route->leg_count = legs;
+    if (workspace->legs[legs - 1].length == 0) {
+        route->leg_count--;
+    }
+    if (workspace->legs[0].length == 0) {
+        route->legs++;
+        route->leg_count--;
+    }
+
+    return 1;
+}
+
+void
+maze_graph_route_expand(Maze *maze, int sx, int sy,
+    const MazeGraphRoute *route, unsigned char *steps)
+{
+    unsigned int x = sx, y = sy;
+    size_t i;
+    uint32_t j;
+
+    for (i = 0; i < route->leg_count; i++) {
+        unsigned char wall = route->legs[i].wall;
+
+        for (j = 0; j < route->legs[i].length; j++) {
+            /* Inside a corridor, there is only one way on */
+            if (j > 0) {
+                wall = doors(maze, x, y) & ~maze_wall_opposite(wall);
+            }
+            *steps++ = wall;
+            x += DX[__builtin_ctz(wall)];
+            y += DY[__builtin_ctz(wall)];
+        }
+    }
+}
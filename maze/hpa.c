@@ -0,0 +1,950 @@
+#include <string.h>
+
+#include "maze-hpa.h"
+
+/**
+ * The default width and height of a cluster.
+ */
+#define DEFAULT_CLUSTER_SIZE 32
+
+/**
+ * The maximum width and height of a cluster; distances within a cluster must
+ * fit in 16 bits.
+ */
+#define MAX_CLUSTER_SIZE 255
+
+/**
+ * The number of heap entries and links initially allocated.
+ */
+#define MIN_CAPACITY 64
+
+/**
+ * Marks border positions without an entrance.
+ */
+#define NO_ENTRANCE UINT16_MAX
+
+/**
+ * Marks rooms not reached by a search within a cluster.
+ */
+#define UNVISITED UINT16_MAX
+
+/**
+ * Marks the absence of a node.
+ */
+#define NONE UINT32_MAX
+
+/**
+ * The offsets of the room behind each wall, indexed by the bit of the wall.
+ */
+static const int DX[4] = {-1, 0, 1, 0};
+static const int DY[4] = {0, -1, 0, 1};
+
+/**
+ * A room of a cluster with doors leading into other clusters.
+ */
+typedef struct {
+    /** The coordinates of the room within the cluster */
+    unsigned char x, y;
+} Entrance;
+
+/**
+ * The shortest path within a cluster from one entrance to another.
+ */
+typedef struct {
+    /** The entrance the path leads to */
+    uint16_t entrance;
+
+    /** The number of steps */
+    uint16_t length;
+} Link;
+
+/**
+ * A cluster of rooms.
+ */
+typedef struct {
+    /** The entrances */
+    Entrance *entrances;
+    size_t count;
+
+    /** The entrance at every position of the four sides of the cluster,
+        indexed by the bit of the wall of the side */
+    uint16_t *border;
+
+    /** The links leaving every entrance are those from offsets[e] up to,
+        but not including, offsets[e + 1] */
+    uint32_t *offsets;
+    Link *links;
+
+    /** Whether the cluster must be rebuilt */
+    int dirty;
+} Cluster;
+
+/**
+ * The state of an entrance during a search.
+ */
+typedef struct {
+    /** Twice the generation for entrances in the open set, one more for
+        closed entrances, and anything else for entrances not seen by the
+        current search */
+    uint32_t stamp;
+
+    /** The length of the best known path to the entrance */
+    uint32_t cost;
+
+    /** The node the entrance was reached from, or NONE for entrances of
+        the first cluster reached directly from the first room */
+    uint32_t previous;
+
+    /** The cluster and the index of the entrance */
+    uint32_t cluster;
+    uint16_t entrance;
+} Node;
+
+/**
+ * An entry of the open set.
+ */
+typedef struct {
+    /** The length of the best known path through the node plus the estimate
+        of the remaining steps */
+    size_t cost;
+
+    /** The node */
+    uint32_t node;
+} Entry;
+
+struct MazeHpa {
+    /** The maze */
+    Maze *maze;
+
+    /** The width and height of a cluster */
+    unsigned int size;
+
+    /** The clusters, row by row */
+    Cluster *clusters;
+    unsigned int clusters_x, clusters_y;
+    size_t cluster_count;
+
+    /** The clusters to rebuild */
+    uint32_t *dirty;
+    size_t dirty_count;
+
+    /** The node of the first entrance of every cluster; the nodes of all
+        clusters are numbered consecutively */
+    uint32_t *bases;
+
+    /** The distances and the queue of a search within a cluster */
+    uint16_t *distances;
+    uint16_t *queue;
+
+    /** The distance from every entrance of the cluster of the last room to
+        the last room, or NONE */
+    uint32_t *targets;
+
+    /** The state of every node, and the current search */
+    Node *nodes;
+    size_t node_capacity;
+    uint32_t generation;
+
+    /** The open set, as a binary heap */
+    Entry *heap;
+    size_t heap_count, heap_capacity;
+
+    /** The steps of the last path */
+    unsigned char *steps;
+    size_t steps_capacity;
+};
+
+/**
+ * Finds the doors of a room leading to other rooms of the maze.
+ *
+ * @param maze
+ *     The maze.
+ * @param x, y
+ *     The coordinates of the room. This must be within the maze.
+ * @return the open walls of the room, except those leading out of the maze
+ */
+static inline unsigned int
+doors(Maze *maze, unsigned int x, unsigned int y)
+{
+    unsigned int result = maze->walls[maze_index(maze, x, y)];
+
+    if (x == 0) {
+        result &= ~MAZE_WALL_LEFT;
+    }
+    if (y == 0) {
+        result &= ~MAZE_WALL_UP;
+    }
+    if (x == maze->width - 1) {
+        result &= ~MAZE_WALL_RIGHT;
+    }
+    if (y == maze->height - 1) {
+        result &= ~MAZE_WALL_DOWN;
+    }
+
+    return result;
+}
+
+/**
+ * Finds the doors of a room leading to other rooms of its cluster.
+ *
+ * @param hpa
+ *     The index.
+ * @param x, y
+ *     The coordinates of the room. This must be within the maze.
+ * @return the open walls of the room leading to rooms of the same cluster
+ */
+static inline unsigned int
+inner_doors(MazeHpa *hpa, unsigned int x, unsigned int y)
+{
+    unsigned int result = doors(hpa->maze, x, y);
+
+    if (x % hpa->size == 0) {
+        result &= ~MAZE_WALL_LEFT;
+    }
+    if (y % hpa->size == 0) {
+        result &= ~MAZE_WALL_UP;
+    }
+    if (x % hpa->size == hpa->size - 1) {
+        result &= ~MAZE_WALL_RIGHT;
+    }
+    if (y % hpa->size == hpa->size - 1) {
+        result &= ~MAZE_WALL_DOWN;
+    }
+
+    return result;
+}
+
+/**
+ * Finds the cluster of a room.
+ */
+static inline size_t
+cluster_of(MazeHpa *hpa, unsigned int x, unsigned int y)
+{
+    return (size_t)(y / hpa->size) * hpa->clusters_x + x / hpa->size;
+}
+
+/**
+ * Finds the area of a cluster.
+ *
+ * @param hpa
+ *     The index.
+ * @param cluster
+ *     The index of the cluster.
+ * @param x, y
+ *     Receive the coordinates of the top left room.
+ * @param width, height
+ *     Receive the dimensions; clusters along the right and bottom edges of
+ *     the maze may be smaller than the others.
+ */
+static inline void
+cluster_bounds(MazeHpa *hpa, size_t cluster, unsigned int *x, unsigned int *y,
+    unsigned int *width, unsigned int *height)
+{
+    *x = cluster % hpa->clusters_x * hpa->size;
+    *y = cluster / hpa->clusters_x * hpa->size;
+    *width = hpa->maze->width - *x < hpa->size
+        ? hpa->maze->width - *x
+        : hpa->size;
+    *height = hpa->maze->height - *y < hpa->size
+        ? hpa->maze->height - *y
+        : hpa->size;
+}
+
+/**
+ * Finds the position of a room along a side of its cluster.
+ *
+ * @param size
+ *     The size of a cluster.
+ * @param x, y
+ *     The coordinates of the room within the cluster.
+ * @param d
+ *     The bit of the wall of the side.
+ * @return the index into the border of the cluster
+ */
+static inline size_t
+border_index(unsigned int size, unsigned int x, unsigned int y, int d)
+{
+    return d * size + (d % 2 ? x : y);
+}
+
+/**
+ * Calculates the distance from a room to all other rooms of its cluster,
+ * without leaving the cluster.
+ *
+ * The distance of the room at (x, y) within the cluster is stored at
+ * y * width + x of the distances of the index.
+ *
+ * @param hpa
+ *     The index.
+ * @param cluster
+ *     The index of the cluster.
+ * @param x, y
+ *     The coordinates of the room.
+ */
+static void
+cluster_search(MazeHpa *hpa, size_t cluster, unsigned int x, unsigned int y)
+{
+    uint16_t *distances = hpa->distances;
+    uint16_t *queue = hpa->queue;
+    unsigned int cx, cy, width, height;
+    size_t head, tail;
+
+    cluster_bounds(hpa, cluster, &cx, &cy, &width, &height);
+    memset(distances, 0xFF, sizeof(uint16_t) * width * height);
+
+    queue[0] = (y - cy) * width + x - cx;
+    distances[queue[0]] = 0;
+    for (head = 0, tail = 1; head < tail; head++) {
+        unsigned int room = queue[head];
+        unsigned int open = inner_doors(hpa, cx + room % width,
+            cy + room / width);
+
+        for (; open; open &= open - 1) {
+            int d = __builtin_ctz(open);
+            unsigned int next = room + DX[d] + DY[d] * (int)width;
+
+            if (distances[next] == UNVISITED) {
+                distances[next] = distances[room] + 1;
+                queue[tail++] = next;
+            }
+        }
+    }
+}
+
+/**
+ * Records the steps of a shortest path between two rooms of a cluster that
+ * does not leave the cluster.
+ *
+ * @param hpa
+ *     The index.
+ * @param cluster
+ *     The index of the cluster.
+ * @param ax, ay
+ *     The coordinates of the first room.
+ * @param bx, by
+ *     The coordinates of the last room. This must be reachable from the
+ *     first room within the cluster.
+ * @param steps
+ *     Receives the steps.
+ */
+static void
+cluster_walk(MazeHpa *hpa, size_t cluster, unsigned int ax, unsigned int ay,
+    unsigned int bx, unsigned int by, unsigned char *steps)
+{
+    unsigned int cx, cy, width, height;
+    unsigned int room;
+
+    cluster_search(hpa, cluster, bx, by);
+    cluster_bounds(hpa, cluster, &cx, &cy, &width, &height);
+
+    /* Walk downhill from the first room */
+    for (room = (ay - cy) * width + ax - cx; hpa->distances[room] > 0; ) {
+        unsigned int x = cx + room % width;
+        unsigned int y = cy + room / width;
+        unsigned int open;
+
+        for (open = inner_doors(hpa, x, y); open; open &= open - 1) {
+            int d = __builtin_ctz(open);
+            unsigned int next = room + DX[d] + DY[d] * (int)width;
+
+            if (hpa->distances[next] == hpa->distances[room] - 1) {
+                *steps++ = 1 << d;
+                room = next;
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * Rebuilds the entrances and links of a cluster.
+ *
+ * @param hpa
+ *     The index.
+ * @param index
+ *     The index of the cluster.
+ * @return non-zero unless memory could not be allocated, in which case the
+ *     cluster is unchanged
+ */
+static int
+cluster_build(MazeHpa *hpa, size_t index)
+{
+    Cluster *cluster = &hpa->clusters[index];
+    unsigned int cx, cy, width, height, x, y;
+    Entrance *entrances;
+    uint16_t *border;
+    uint32_t *offsets;
+    Link *links, *larger;
+    size_t count = 0, link_count = 0, capacity = MIN_CAPACITY, i, j;
+
+    cluster_bounds(hpa, index, &cx, &cy, &width, &height);
+    entrances = malloc(sizeof(Entrance) * 4 * hpa->size);
+    border = malloc(sizeof(uint16_t) * 4 * hpa->size);
+    offsets = malloc(sizeof(uint32_t) * (4 * hpa->size + 1));
+    links = malloc(sizeof(Link) * capacity);
+    if (!entrances || !border || !offsets || !links) {
+        free(entrances);
+        free(border);
+        free(offsets);
+        free(links);
+        return 0;
+    }
+
+    /* The rooms along the sides with doors into other clusters */
+    memset(border, 0xFF, sizeof(uint16_t) * 4 * hpa->size);
+    for (y = 0; y < height; y++) {
+        for (x = 0; x < width; x++) {
+            unsigned int outer;
+
+            if (x > 0 && y > 0 && x < width - 1 && y < height - 1) {
+                continue;
+            }
+
+            outer = doors(hpa->maze, cx + x, cy + y)
+                & ~inner_doors(hpa, cx + x, cy + y);
+            if (!outer) {
+                continue;
+            }
+            for (; outer; outer &= outer - 1) {
+                border[border_index(hpa->size, x, y, __builtin_ctz(outer))]
+                    = count;
+            }
+            entrances[count].x = x;
+            entrances[count].y = y;
+            count++;
+        }
+    }
+
+    /* The shortest paths between the entrances within the cluster */
+    for (i = 0; i < count; i++) {
+        offsets[i] = link_count;
+        cluster_search(hpa, index, cx + entrances[i].x, cy + entrances[i].y);
+        for (j = 0; j < count; j++) {
+            uint16_t distance = hpa->distances[
+                entrances[j].y * width + entrances[j].x];
+
+            if (j == i || distance == UNVISITED) {
+                continue;
+            }
+
+            if (link_count == capacity) {
+                larger = realloc(links, sizeof(Link) * 2 * capacity);
+                if (!larger) {
+                    free(entrances);
+                    free(border);
+                    free(offsets);
+                    free(links);
+                    return 0;
+                }
+                links = larger;
+                capacity *= 2;
+            }
+            links[link_count].entrance = j;
+            links[link_count].length = distance;
+            link_count++;
+        }
+    }
+    offsets[count] = link_count;
+
+    free(cluster->entrances);
+    free(cluster->border);
+    free(cluster->offsets);
+    free(cluster->links);
+    cluster->entrances = entrances;
+    cluster->count = count;
+    cluster->border = border;
+    cluster->offsets = offsets;
+    cluster->links = links;
+
+    return 1;
+}
+
+/**
+ * Marks a cluster to be rebuilt.
+ */
+static void
+cluster_mark(MazeHpa *hpa, size_t cluster)
+{
+    if (!hpa->clusters[cluster].dirty) {
+        hpa->clusters[cluster].dirty = 1;
+        hpa->dirty[hpa->dirty_count++] = cluster;
+    }
+}
+
+/**
+ * Rebuilds all marked clusters, numbers the nodes and prepares a new search.
+ *
+ * @param hpa
+ *     The index.
+ * @return non-zero unless memory could not be allocated
+ */
+static int
+prepare(MazeHpa *hpa)
+{
+    size_t count, i;
+
+    if (hpa->dirty_count > 0) {
+        while (hpa->dirty_count > 0) {
+            size_t cluster = hpa->dirty[hpa->dirty_count - 1];
+
+            if (!cluster_build(hpa, cluster)) {
+                return 0;
+            }
+            hpa->clusters[cluster].dirty = 0;
+            hpa->dirty_count--;
+        }
+
+        for (count = 0, i = 0; i < hpa->cluster_count; i++) {
+            hpa->bases[i] = count;
+            count += hpa->clusters[i].count;
+        }
+        hpa->bases[i] = count;
+    }
+    count = hpa->bases[hpa->cluster_count];
+
+    /* The stamps of the previous searches are forgotten when the array is
+       replaced, or when the generation would wrap around */
+    if (hpa->node_capacity < count
+            || hpa->generation >= UINT32_MAX / 2 - 1) {
+        size_t capacity = count > hpa->node_capacity
+            ? count
+            : hpa->node_capacity;
+
+        free(hpa->nodes);
+        hpa->nodes = calloc(capacity ? capacity : 1, sizeof(Node));
+        hpa->generation = 0;
+        hpa->node_capacity = hpa->nodes ? capacity : 0;
+        if (!hpa->nodes) {
+            return 0;
+        }
+    }
+
+    hpa->heap_count = 0;
+    hpa->generation++;
+
+    return 1;
+}
+
+/**
+ * Adds a node to the open set.
+ *
+ * @param hpa
+ *     The index.
+ * @param cost
+ *     The cost of the node.
+ * @param node
+ *     The node.
+ * @return non-zero unless memory could not be allocated
+ */
+static int
+heap_push(MazeHpa *hpa, size_t cost, uint32_t node)
+{
+    Entry *heap = hpa->heap;
+    size_t i = hpa->heap_count;
+
+    if (i == hpa->heap_capacity) {
+        heap = realloc(heap, sizeof(Entry) * 2 * hpa->heap_capacity);
+        if (!heap) {
+            return 0;
+        }
+        hpa->heap = heap;
+        hpa->heap_capacity *= 2;
+    }
+
+    for (; i > 0 && heap[(i - 1) / 2].cost > cost; i = (i - 1) / 2) {
+        heap[i] = heap[(i - 1) / 2];
+    }
+    heap[i].cost = cost;
+    heap[i].node = node;
+    hpa->heap_count++;
+
+    return 1;
+}
+
+/**
+ * Removes the node with the lowest cost from the open set.
+ *
+ * @param hpa
+ *     The index. The open set must not be empty.
+ * @return the entry removed
+ */
+static Entry
+heap_pop(MazeHpa *hpa)
+{
+    Entry *heap = hpa->heap;
+    Entry result = heap[0];
+    Entry last = heap[--hpa->heap_count];
+    size_t count = hpa->heap_count;
+    size_t i = 0;
+
+    for (;;) {
+        size_t child = 2 * i + 1;
+
+        if (child >= count) {
+            break;
+        }
+        if (child + 1 < count && heap[child + 1].cost < heap[child].cost) {
+            child++;
+        }
+        if (heap[child].cost >= last.cost) {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = last;
+
+    return result;
+}
+
+/**
+ * Finds the room of an entrance.
+ *
+ * @param hpa
+ *     The index.
+ * @param cluster
+ *     The index of the cluster.
+ * @param entrance
+ *     The index of the entrance.
+ * @param x, y
+ *     Receive the coordinates of the room.
+ */
+static inline void
+entrance_room(MazeHpa *hpa, size_t cluster, size_t entrance, unsigned int *x,
+    unsigned int *y)
+{
+    *x = cluster % hpa->clusters_x * hpa->size
+        + hpa->clusters[cluster].entrances[entrance].x;
+    *y = cluster / hpa->clusters_x * hpa->size
+        + hpa->clusters[cluster].entrances[entrance].y;
+}
+
+/**
+ * Records a path to an entrance, unless a path at least as short is known.
+ *
+ * @param hpa
+ *     The index.
+ * @param cluster, entrance
+ *     The entrance.
+ * @param cost
+ *     The length of the path.
+ * @param previous
+ *     The node the path leads through.
+ * @param tx, ty
+ *     The coordinates of the last room.
+ * @return non-zero unless memory could not be allocated
+ */
+static inline int
+relax(MazeHpa *hpa, size_t cluster, size_t entrance, uint32_t cost,
+    uint32_t previous, unsigned int tx, unsigned int ty)
+{
+    uint32_t node = hpa->bases[cluster] + entrance;
+    Node *state = &hpa->nodes[node];
+    uint32_t open = 2 * hpa->generation;
+    unsigned int x, y;
+
+    if (state->stamp == open + 1 || (state->stamp == open
+            && state->cost <= cost)) {
+        return 1;
+    }
+    state->stamp = open;
+    state->cost = cost;
+    state->previous = previous;
+    state->cluster = cluster;
+    state->entrance = entrance;
+
+    /* The Manhattan distance never exceeds the length of a path, and
+       changes by at most one with every step, so it is consistent */
+    entrance_room(hpa, cluster, entrance, &x, &y);
+
+    return heap_push(hpa, (size_t)cost + (x > tx ? x - tx : tx - x)
+        + (y > ty ? y - ty : ty - y), node);
+}
+
+/**
+ * Finds the length of a shortest path between two rooms.
+ *
+ * @param hpa
+ *     The index.
+ * @param sx, sy
+ *     The coordinates of the first room.
+ * @param tx, ty
+ *     The coordinates of the last room.
+ * @param length
+ *     Receives the length of the path.
+ * @param end
+ *     Receives the last node of the path, or NONE if the path does not leave
+ *     the cluster of the rooms.
+ * @return non-zero if a path was found, or 0 if the rooms are not connected
+ *     or memory could not be allocated
+ */
+static int
+search(MazeHpa *hpa, unsigned int sx, unsigned int sy, unsigned int tx,
+    unsigned int ty, size_t *length, uint32_t *end)
+{
+    size_t start = cluster_of(hpa, sx, sy);
+    size_t target = cluster_of(hpa, tx, ty);
+    size_t best = SIZE_MAX;
+    unsigned int cx, cy, width, height;
+    uint32_t closed;
+    Cluster *cluster;
+    size_t i;
+
+    *end = NONE;
+    if (!prepare(hpa)) {
+        return 0;
+    }
+    closed = 2 * hpa->generation + 1;
+
+    /* The distances from the entrances of the last cluster to the last room,
+       and to the first room if it lies in the same cluster */
+    cluster = &hpa->clusters[target];
+    cluster_bounds(hpa, target, &cx, &cy, &width, &height);
+    cluster_search(hpa, target, tx, ty);
+    for (i = 0; i < cluster->count; i++) {
+        uint16_t distance = hpa->distances[
+            cluster->entrances[i].y * width + cluster->entrances[i].x];
+
+        hpa->targets[i] = distance == UNVISITED ? NONE : distance;
+    }
+    if (start == target
+            && hpa->distances[(sy - cy) * width + sx - cx] != UNVISITED) {
+        best = hpa->distances[(sy - cy) * width + sx - cx];
+    }
+
+    /* The entrances of the first cluster reachable from the first room */
+    cluster = &hpa->clusters[start];
+    cluster_bounds(hpa, start, &cx, &cy, &width, &height);
+    cluster_search(hpa, start, sx, sy);
+    for (i = 0; i < cluster->count; i++) {
+        uint16_t distance = hpa->distances[
+            cluster->entrances[i].y * width + cluster->entrances[i].x];
+
+        if (distance != UNVISITED
+                && !relax(hpa, start, i, distance, NONE, tx, ty)) {
+            return 0;
+        }
+    }
+
+    while (hpa->heap_count > 0) {
+        Entry entry = heap_pop(hpa);
+        Node *state = &hpa->nodes[entry.node];
+        unsigned int x, y, outer;
+        uint32_t l;
+
+        if (state->stamp == closed) {
+            continue;
+        }
+        if (entry.cost >= best) {
+            break;
+        }
+        state->stamp = closed;
+
+        cluster = &hpa->clusters[state->cluster];
+        if (state->cluster == target && hpa->targets[state->entrance] != NONE
+                && (size_t)state->cost + hpa->targets[state->entrance]
+                    < best) {
+            best = (size_t)state->cost + hpa->targets[state->entrance];
+            *end = entry.node;
+        }
+
+        /* Across the cluster */
+        for (l = cluster->offsets[state->entrance];
+                l < cluster->offsets[state->entrance + 1]; l++) {
+            if (!relax(hpa, state->cluster, cluster->links[l].entrance,
+                    state->cost + cluster->links[l].length, entry.node,
+                    tx, ty)) {
+                return 0;
+            }
+        }
+
+        /* Through the doors into the neighbouring clusters */
+        entrance_room(hpa, state->cluster, state->entrance, &x, &y);
+        outer = doors(hpa->maze, x, y) & ~inner_doors(hpa, x, y);
+        for (; outer; outer &= outer - 1) {
+            int d = __builtin_ctz(outer);
+            unsigned int nx = x + DX[d];
+            unsigned int ny = y + DY[d];
+            size_t next = cluster_of(hpa, nx, ny);
+            size_t entrance = hpa->clusters[next].border[border_index(
+                hpa->size, nx % hpa->size, ny % hpa->size, d ^ 2)];
+
+            if (entrance != NO_ENTRANCE && !relax(hpa, next, entrance,
+                    state->cost + 1, entry.node, tx, ty)) {
+                return 0;
+            }
+        }
+    }
+
+    *length = best;
+
+    return best != SIZE_MAX;
+}
+
+MazeHpa*
+maze_hpa_create(Maze *maze, unsigned int cluster_size)
+{
+    MazeHpa *result;
+    size_t i;
+
+    if (cluster_size == 0) {
+        cluster_size = DEFAULT_CLUSTER_SIZE;
+    }
+    if (maze->width == 0 || maze->height == 0
+            || (size_t)maze->width * maze->height >= UINT32_MAX
+            || cluster_size > MAX_CLUSTER_SIZE) {
+        return NULL;
+    }
+
+    result = malloc(sizeof(MazeHpa));
+    if (!result) {
+        return NULL;
+    }
+    result->maze = maze;
+    result->size = cluster_size;
+    result->clusters_x = (maze->width + cluster_size - 1) / cluster_size;
+    result->clusters_y = (maze->height + cluster_size - 1) / cluster_size;
+    result->cluster_count = (size_t)result->clusters_x * result->clusters_y;
+    result->clusters = calloc(result->cluster_count, sizeof(Cluster));
+    result->dirty = malloc(sizeof(uint32_t) * result->cluster_count);
+    result->dirty_count = 0;
+    result->bases = malloc(sizeof(uint32_t) * (result->cluster_count + 1));
+    result->distances = malloc(
+        sizeof(uint16_t) * cluster_size * cluster_size);
+    result->queue = malloc(sizeof(uint16_t) * cluster_size * cluster_size);
+    result->targets = malloc(sizeof(uint32_t) * 4 * cluster_size);
+    result->nodes = NULL;
+    result->node_capacity = 0;
+    result->generation = 0;
+    result->heap = malloc(sizeof(Entry) * MIN_CAPACITY);
+    result->heap_count = 0;
+    result->heap_capacity = MIN_CAPACITY;
+    result->steps = NULL;
+    result->steps_capacity = 0;
+    if (!result->clusters || !result->dirty || !result->bases
+            || !result->distances || !result->queue || !result->targets
+            || !result->heap) {
+        maze_hpa_free(result);
+        return NULL;
+    }
+
+    /* All clusters are built by the first search */
+    for (i = 0; i < result->cluster_count; i++) {
+        cluster_mark(result, i);
+    }
+
+    return result;
+}
+
+void
+maze_hpa_free(MazeHpa *hpa)
+{
+    size_t i;
+
+    for (i = 0; hpa->clusters && i < hpa->cluster_count; i++) {
+        free(hpa->clusters[i].entrances);
+        free(hpa->clusters[i].border);
+        free(hpa->clusters[i].offsets);
+        free(hpa->clusters[i].links);
+    }
+    free(hpa->clusters);
+    free(hpa->dirty);
+    free(hpa->bases);
+    free(hpa->distances);
+    free(hpa->queue);
+    free(hpa->targets);
+    free(hpa->nodes);
+    free(hpa->heap);
+    free(hpa->steps);
+    free(hpa);
+}
+
+void
+maze_hpa_update(MazeHpa *hpa, int x, int y, unsigned char wall)
+{
+    int nx = x, ny = y;
+
+    if (!maze_contains(hpa->maze, x, y)) {
+        return;
+    }
+
+    cluster_mark(hpa, cluster_of(hpa, x, y));
+    if (maze_door_enter(hpa->maze, &nx, &ny, wall, 0)
+            && maze_contains(hpa->maze, nx, ny)) {
+        cluster_mark(hpa, cluster_of(hpa, nx, ny));
+    }
+}
+
+int
+maze_hpa_distance(MazeHpa *hpa, int sx, int sy, int tx, int ty,
+    size_t *length)
+{
+    uint32_t end;
+
+    return search(hpa, sx, sy, tx, ty, length, &end);
+}
+
+int
+maze_hpa_solve(MazeHpa *hpa, int sx, int sy, int tx, int ty, MazePath *path)
+{
+    size_t length, position;
+    unsigned int ax, ay, bx, by;
+    uint32_t end, node;
+    Node *state;
+
+    if (!search(hpa, sx, sy, tx, ty, &length, &end)) {
+        return 0;
+    }
+
+    if (hpa->steps_capacity < length) {
+        unsigned char *steps = realloc(hpa->steps, length ? length : 1);
+
+        if (!steps) {
+            return 0;
+        }
+        hpa->steps = steps;
+        hpa->steps_capacity = length;
+    }
+    path->length = length;
+    path->steps = hpa->steps;
+
+    if (end == NONE) {
+        cluster_walk(hpa, cluster_of(hpa, sx, sy), sx, sy, tx, ty,
+            hpa->steps);
+        return 1;
+    }
+
+    /* Refine the path backwards from the last room, one part at a time */
+    state = &hpa->nodes[end];
+    entrance_room(hpa, state->cluster, state->entrance, &ax, &ay);
+    position = length - hpa->targets[state->entrance];
+    cluster_walk(hpa, state->cluster, ax, ay, tx, ty, hpa->steps + position);
+
+    for (node = end; hpa->nodes[node].previous != NONE;
+            node = hpa->nodes[node].previous) {
+        Node *previous = &hpa->nodes[hpa->nodes[node].previous];
+
+        state = &hpa->nodes[node];
+        entrance_room(hpa, previous->cluster, previous->entrance, &ax, &ay);
+        entrance_room(hpa, state->cluster, state->entrance, &bx, &by);
+        position -= state->cost - previous->cost;
+
+        /* Entrances of different clusters are joined by a single door */
+        if (previous->cluster != state->cluster) {
+            hpa->steps[position] = bx < ax ? MAZE_WALL_LEFT
+                : by < ay ? MAZE_WALL_UP
+                : bx > ax ? MAZE_WALL_RIGHT
+                : MAZE_WALL_DOWN;
+        }
+        else {
+            cluster_walk(hpa, state->cluster, ax, ay, bx, by,
+                hpa->steps + position);
+        }
+    }
+
+    state = &hpa->nodes[node];
+    entrance_room(hpa, state->cluster, state->entrance, &bx, &by);
+    cluster_walk(hpa, state->cluster, sx, sy, bx, by, hpa->steps);
+
+    return 1;
+}
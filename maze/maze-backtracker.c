@@ -0,0 +1,277 @@
+#include <limits.h>
+#include <stdlib.h>
+
+#include "maze.h"
+
+/**
+ * The walls in the order of their direction indices.
+ */
+static const unsigned char WALLS[] = {
+    MAZE_WALL_LEFT, MAZE_WALL_UP, MAZE_WALL_RIGHT, MAZE_WALL_DOWN};
+
+/**
+ * The horizontal and vertical movement for every direction index.
+ */
+static const int DX[] = {-1, 0, 1, 0};
+static const int DY[] = {0, -1, 0, 1};
+
+/**
+ * Determines whether a room in the area has been visited.
+ *
+ * @param visited
+ *     A bit mask with one bit per room in the area.
+ * @param index
+ *     The index of the room in the area.
+ * @return non-zero if the room has been visited
+ */
+static inline int
+is_visited(const unsigned char *visited, size_t index)
+{
+    return visited[index / 8] & (1 << (index % 8));
+}
+
+/**
+ * Pushes a direction index onto the stack.
+ *
+ * Every item uses two bits, so four items are packed into every byte.
+ *
+ * @param stack
+ *     The stack.
+ * @param depth
+ *     The current number of items on the stack. This is incremented.
+ * @param direction
+ *     The direction index to push.
+ */
+static inline void
+stack_push(unsigned char *stack, size_t *depth, unsigned int direction)
+{
+    unsigned int shift = (*depth % 4) * 2;
+
+    stack[*depth / 4] = (stack[*depth / 4] & ~(3 << shift))
+        | (direction << shift);
+    (*depth)++;
+}
+
+/**
+ * Pops a direction index from the stack.
+ *
+ * @param stack
+ *     The stack.
+ * @param depth
+ *     The current number of items on the stack. This is decremented, and must
+ *     not be 0.
+ * @return the direction index
+ */
+static inline unsigned int
+stack_pop(const unsigned char *stack, size_t *depth)
+{
+    (*depth)--;
+
+    return (stack[*depth / 4] >> ((*depth % 4) * 2)) & 3;
+}
+
+/**
+ * The state of an initialisation.
+ */
+typedef struct {
+    /** The maze being initialised */
+    Maze *maze;
+
+    /** The random number generator */
+    MazeRandom *random;
+
+    /** The area being initialised */
+    int x, y;
+    unsigned int width, height;
+
+    /** The callback function and its context */
+    MazeInitializeCallback callback;
+    void *context;
+
+    /** A bit mask with one bit per room in the area */
+    unsigned char *visited;
+
+    /** The direction used to enter every room on the current path */
+    unsigned char *stack;
+
+    /** The number of items on the stack */
+    size_t depth;
+
+    /** The number of rooms not yet visited */
+    size_t remaining;
+
+    /** The current room, relative to the area */
+    int cx, cy;
+} Backtracker;
+
+/**
+ * Starts initialising a rectangular area of the maze.
+ *
+ * @see MazeGeneratorType.begin
+ */
+static void*
+begin(Maze *maze, MazeRandom *random,
+    int x, int y, unsigned int width, unsigned int height,
+    MazeInitializeCallback callback, void *context)
+{
+    Backtracker *state;
+    size_t rooms, index;
+
+    state = malloc(sizeof(Backtracker));
+    if (!state) {
+        return NULL;
+    }
+
+    /* Every room is pushed at most once, so the stack never grows */
+    rooms = (size_t)width * height;
+    state->visited = calloc((rooms + 7) / 8, 1);
+    state->stack = malloc((rooms + 3) / 4);
+    if (!state->visited || !state->stack) {
+        free(state->visited);
+        free(state->stack);
+        free(state);
+        return NULL;
+    }
+
+    state->maze = maze;
+    state->random = random;
+    state->x = x;
+    state->y = y;
+    state->width = width;
+    state->height = height;
+    state->callback = callback;
+    state->context = context;
+    state->depth = 0;
+    state->remaining = rooms - 1;
+    state->cx = maze_random_range(random, width);
+    state->cy = maze_random_range(random, height);
+
+    index = (size_t)state->cy * width + state->cx;
+    state->visited[index / 8] |= 1 << (index % 8);
+    if (callback) {
+        maze_data_set(maze, x + state->cx, y + state->cy,
+            callback(context, maze, x + state->cx, y + state->cy, NULL));
+    }
+
+    return state;
+}
+
+/**
+ * Walks the maze, opening doors to unvisited rooms and backing up at dead
+ * ends.
+ *
+ * Every step forward or back counts towards max_rooms.
+ *
+ * @see MazeGeneratorType.step
+ */
+static int
+step(void *state, unsigned int max_rooms, size_t *rooms)
+{
+    Backtracker *b = state;
+    unsigned int steps;
+
+    /* The walk is complete as soon as all rooms have been visited; there is
+       no need to back up to the start */
+    for (steps = 0; steps < max_rooms && b->remaining > 0; steps++) {
+        unsigned int candidates[4];
+        unsigned int count = 0, direction;
+
+        /* Find all unvisited neighbours */
+        for (direction = 0; direction < 4; direction++) {
+            int nx = b->cx + DX[direction];
+            int ny = b->cy + DY[direction];
+
+            if (nx >= 0 && nx < (int)b->width
+                    && ny >= 0 && ny < (int)b->height
+                    && !is_visited(b->visited,
+                        (size_t)ny * b->width + nx)) {
+                candidates[count++] = direction;
+            }
+        }
+
+        if (count > 0) {
+            size_t index;
+            int rx, ry;
+
+            direction = candidates[maze_random_range(b->random, count)];
+            maze_door_open(b->maze, b->x + b->cx, b->y + b->cy,
+                WALLS[direction]);
+            b->cx += DX[direction];
+            b->cy += DY[direction];
+
+            index = (size_t)b->cy * b->width + b->cx;
+            b->visited[index / 8] |= 1 << (index % 8);
+            stack_push(b->stack, &b->depth, direction);
+            b->remaining--;
+            (*rooms)++;
+
+            if (b->callback) {
+                rx = b->x + b->cx;
+                ry = b->y + b->cy;
+                maze_data_set(b->maze, rx, ry,
+                    b->callback(b->context, b->maze, rx, ry, NULL));
+            }
+        }
+        else {
+            /* Step back through the door we entered by */
+            direction = stack_pop(b->stack, &b->depth);
+            b->cx -= DX[direction];
+            b->cy -= DY[direction];
+        }
+    }
+
+    return b->remaining > 0;
+}
+
+/**
+ * Releases the state.
+ *
+ * @see MazeGeneratorType.end
+ */
+static void
+end(void *state)
+{
+    Backtracker *b = state;
+
+    free(b->visited);
+    free(b->stack);
+    free(b);
+}
+
+/**
+ * Initialises a rectangular area of the maze with the Recursive Backtracker
+ * algorithm.
+ *
+ * @see MazeGeneratorType.initialize_region
+ */
+static int
+initialize_region(Maze *maze, MazeRandom *random,
+    int x, int y, unsigned int width, unsigned int height,
+    MazeInitializeCallback callback, void *context)
+{
+    void *state;
+    size_t rooms = 0;
+
+    if (width == 0 || height == 0 || !maze_contains(maze, x, y)
+            || !maze_contains(maze, x + width - 1, y + height - 1)) {
+        return 1;
+    }
+
+    state = begin(maze, random, x, y, width, height, callback, context);
+    if (!state) {
+        return 0;
+    }
+    while (step(state, UINT_MAX, &rooms));
+    end(state);
+
+    return 1;
+}
+
+const MazeGeneratorType MAZE_GENERATOR_BACKTRACKER = {
+    MAZE_GENERATOR_ID_BACKTRACKER,
+    "backtracker",
+    initialize_region,
+    begin,
+    step,
+    end
+};
@@ -0,0 +1,93 @@
+#include <stdlib.h>
+
+#include "maze.h"
+
+/**
+ * Initialises a rectangular area of the maze with the Binary Tree algorithm.
+ *
+ * Every room opens either its door up or its door to the left, chosen by one
+ * random bit. The doors of a row are computed into a buffer without branching
+ * on the random bits, and are then merged into the row and the row above.
+ *
+ * @see MazeGeneratorType.initialize_region
+ */
+static int
+initialize_region(Maze *maze, MazeRandom *random,
+    int x, int y, unsigned int width, unsigned int height,
+    MazeInitializeCallback callback, void *context)
+{
+    unsigned char *walls, *down;
+    uint64_t *bits;
+    unsigned int words, rx, ry, i;
+
+    if (width == 0 || height == 0 || !maze_contains(maze, x, y)
+            || !maze_contains(maze, x + width - 1, y + height - 1)) {
+        return 1;
+    }
+
+    /* The buffer has room for a sentinel after the last room, followed by the
+       doors to open in the row above */
+    words = (width + 63) / 64;
+    walls = malloc(2 * width + 1);
+    bits = malloc(sizeof(uint64_t) * words);
+    if (!walls || !bits) {
+        free(walls);
+        free(bits);
+        return 0;
+    }
+    down = walls + width + 1;
+
+    for (ry = 0; ry < height; ry++) {
+        for (i = 0; i < words; i++) {
+            bits[i] = maze_random_next(random);
+        }
+
+        /* The top row can only open doors to the left and the leftmost column
+           only doors up; the top left room opens no door */
+        for (rx = 0; rx < width; rx++) {
+            unsigned int can_up = ry > 0;
+            unsigned int can_left = rx > 0;
+            unsigned int bit = (bits[rx / 64] >> (rx % 64)) & 1;
+            unsigned int up = can_up & (bit | !can_left);
+            unsigned int left = can_left & !up;
+
+            walls[rx] = up * MAZE_WALL_UP | left * MAZE_WALL_LEFT;
+        }
+        walls[width] = 0;
+
+        /* Open the matching doors in the row above and to the left */
+        for (rx = 0; rx < width; rx++) {
+            walls[rx] |= (walls[rx + 1] & MAZE_WALL_LEFT) << 2;
+        }
+        if (ry > 0) {
+            for (rx = 0; rx < width; rx++) {
+                down[rx] = (walls[rx] & MAZE_WALL_UP) << 2;
+            }
+            maze_row_merge(maze, x, y + ry - 1, width, down);
+        }
+        maze_row_merge(maze, x, y + ry, width, walls);
+    }
+
+    free(walls);
+    free(bits);
+
+    if (callback) {
+        for (ry = 0; ry < height; ry++) {
+            for (rx = 0; rx < width; rx++) {
+                maze_data_set(maze, x + rx, y + ry,
+                    callback(context, maze, x + rx, y + ry, NULL));
+            }
+        }
+    }
+
+    return 1;
+}
+
+const MazeGeneratorType MAZE_GENERATOR_BINARY_TREE = {
+    MAZE_GENERATOR_ID_BINARY_TREE,
+    "binary-tree",
+    initialize_region,
+    NULL,
+    NULL,
+    NULL
+};
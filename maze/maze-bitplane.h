@@ -0,0 +1,137 @@
+#ifndef MAZE_BITPLANE_H
+#define MAZE_BITPLANE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "maze.h"
+
+/**
+ * The doors of a maze stored as two bit planes.
+ *
+ * Every door is a single bit, and a row of doors is stored in consecutive
+ * 64 bit words, so that queries over a complete maze can process 64 rooms at a
+ * time. Bit x of a row corresponds to room x of the maze; a row has width + 1
+ * bits, and the bits following them in the last word of a row are always 0.
+ *
+ * Bit planes are a copy of a maze made for analysis; they are not updated when
+ * the maze changes.
+ */
+typedef struct {
+    /** The width of the maze */
+    unsigned int width;
+
+    /** The height of the maze */
+    unsigned int height;
+
+    /** The number of words in a row */
+    size_t stride;
+
+    /** The vertical doors; bit x of row y is the left door of the room (x, y),
+        and bit width the right door of the last room. Its size is
+        height * stride */
+    uint64_t *vertical;
+
+    /** The horizontal doors; bit x of row y is the top door of the room
+        (x, y), and row height holds the bottom doors of the last row. Its
+        size is (height + 1) * stride */
+    uint64_t *horizontal;
+} MazeBitplanes;
+
+/**
+ * Creates the bit planes of a maze.
+ *
+ * @param maze
+ *     The maze to copy.
+ * @return new bit planes, or NULL if memory could not be allocated
+ */
+MazeBitplanes*
+maze_bitplanes_create(Maze *maze);
+
+/**
+ * Frees all resources allocated by bit planes.
+ *
+ * @param planes
+ *     The bit planes to release.
+ */
+void
+maze_bitplanes_free(MazeBitplanes *planes);
+
+/**
+ * Counts the open doors.
+ *
+ * Every door is counted once, including doors leading out of the maze.
+ *
+ * @param planes
+ *     The bit planes.
+ * @return the number of open doors
+ */
+uint64_t
+maze_bitplanes_door_count(MazeBitplanes *planes);
+
+/**
+ * Finds the dead ends, the rooms with exactly one open door.
+ *
+ * @param planes
+ *     The bit planes.
+ * @param mask
+ *     An array of height * stride words that receives one bit per room, set
+ *     for dead ends, in the same layout as the vertical plane. This may be
+ *     NULL if only the number of dead ends is required.
+ * @return the number of dead ends
+ */
+uint64_t
+maze_bitplanes_dead_ends(MazeBitplanes *planes, uint64_t *mask);
+
+/**
+ * Calculates which rooms in a row have a corner.
+ *
+ * This is the bulk equivalent of maze_is_corner_up_left and its siblings.
+ *
+ * @param planes
+ *     The bit planes.
+ * @param y
+ *     The row. This must be less than the height.
+ * @param corner
+ *     One of the MAZE_CORNER_* masks.
+ * @param mask
+ *     An array of stride words that receives one bit per room, set if both
+ *     walls of the corner are closed.
+ */
+void
+maze_bitplanes_corners(MazeBitplanes *planes, unsigned int y,
+    unsigned char corner, uint64_t *mask);
+
+/**
+ * Counts the doors that differ between two mazes.
+ *
+ * @param a, b
+ *     The bit planes to compare. These must have the same dimensions.
+ * @return the number of doors open in exactly one of the mazes
+ */
+uint64_t
+maze_bitplanes_compare(MazeBitplanes *a, MazeBitplanes *b);
+
+/**
+ * Retrieves the wall value of a room from bit planes.
+ *
+ * @param planes
+ *     The bit planes.
+ * @param x, y
+ *     The coordinates of the room. These must be within the maze.
+ * @return the value of the room
+ */
+static inline unsigned char
+maze_bitplanes_room_get(MazeBitplanes *planes, unsigned int x, unsigned int y)
+{
+    const uint64_t *vertical = planes->vertical + y * planes->stride;
+    const uint64_t *up = planes->horizontal + y * planes->stride;
+    const uint64_t *down = up + planes->stride;
+
+    return ((vertical[x / 64] >> (x % 64)) & 1) * MAZE_WALL_LEFT
+        | ((up[x / 64] >> (x % 64)) & 1) * MAZE_WALL_UP
+        | ((vertical[(x + 1) / 64] >> ((x + 1) % 64)) & 1) * MAZE_WALL_RIGHT
+        | ((down[x / 64] >> (x % 64)) & 1) * MAZE_WALL_DOWN;
+}
+
+#endif
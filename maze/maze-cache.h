@@ -0,0 +1,115 @@
+#ifndef MAZE_CACHE_H
+#define MAZE_CACHE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "maze.h"
+
+/**
+ * A cache of generated mazes.
+ *
+ * Mazes are identified by the generator, the seed and the dimensions, which
+ * together determine the maze completely. Mazes are kept in memory up to a
+ * byte budget and released in order of last use. If a directory is given,
+ * generated mazes are also saved there with maze_save, and a maze missing from
+ * memory is mapped from its file with maze_map instead of being generated
+ * again.
+ *
+ * A cache may be used from several threads. Mazes are generated without
+ * blocking lookups of other mazes; concurrent lookups of a maze that is being
+ * generated wait for it.
+ */
+typedef struct MazeCache MazeCache;
+
+/**
+ * The counters of a cache.
+ */
+typedef struct {
+    /** The number of lookups that found the maze in memory */
+    uint64_t hits;
+
+    /** The number of lookups that mapped the maze from the directory */
+    uint64_t disk_hits;
+
+    /** The number of lookups that generated the maze */
+    uint64_t misses;
+
+    /** The number of mazes released from memory to stay within the budget */
+    uint64_t evictions;
+
+    /** The number of mazes in memory, and the number of bytes they use */
+    size_t count, bytes;
+} MazeCacheStats;
+
+/**
+ * Creates a new cache.
+ *
+ * @param max_bytes
+ *     The maximum number of bytes to use for mazes in memory. Mazes that are
+ *     in use are never released, so this may be exceeded while they are held.
+ * @param directory
+ *     The directory in which to store mazes, or NULL to only keep them in
+ *     memory. The directory must exist.
+ * @return a new cache, or NULL if memory could not be allocated
+ */
+MazeCache*
+maze_cache_create(size_t max_bytes, const char *directory);
+
+/**
+ * Frees all resources allocated by a cache.
+ *
+ * All mazes retrieved from the cache must have been released.
+ *
+ * @param cache
+ *     The cache to release.
+ */
+void
+maze_cache_free(MazeCache *cache);
+
+/**
+ * Retrieves a maze, generating it if it is not cached.
+ *
+ * The maze is generated with maze_initialize using a random number generator
+ * seeded with maze_random_seed. The returned maze is shared with all other
+ * users of the cache and must not be modified; release it with
+ * maze_cache_release, not maze_free.
+ *
+ * @param cache
+ *     The cache.
+ * @param type
+ *     The algorithm used to generate the maze.
+ * @param seed
+ *     The seed of the random number generator.
+ * @param width, height
+ *     The dimensions of the maze.
+ * @return the maze, or NULL if memory could not be allocated or the maze could
+ *     not be generated
+ */
+Maze*
+maze_cache_get(MazeCache *cache, const MazeGeneratorType *type,
+    uint64_t seed, unsigned int width, unsigned int height);
+
+/**
+ * Releases a maze retrieved with maze_cache_get.
+ *
+ * @param cache
+ *     The cache.
+ * @param maze
+ *     The maze to release.
+ */
+void
+maze_cache_release(MazeCache *cache, Maze *maze);
+
+/**
+ * Retrieves the counters of a cache.
+ *
+ * @param cache
+ *     The cache.
+ * @param stats
+ *     Receives the counters.
+ */
+void
+maze_cache_stats(MazeCache *cache, MazeCacheStats *stats);
+
+#endif
@@ -0,0 +1,205 @@
+#ifndef MAZE_CODEC_H
+#define MAZE_CODEC_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "maze.h"
+
+/**
+ * A compact serialisation of the doors of a maze.
+ *
+ * Every door between two rooms is shared by both rooms, so only the right and
+ * bottom doors of every room are stored, along with the doors leading out of
+ * the maze on its top and left sides; this is about 2 bits per room instead of
+ * the 4 bits of a room value. The bits may optionally be compressed further
+ * with an adaptive binary range coder, which predicts every door from the
+ * doors around it that have already been coded.
+ *
+ * A stream starts with a 16 byte header: the magic bytes "MAZC", a version
+ * byte, a flags byte, two reserved bytes and the width and height as little
+ * endian 32 bit numbers. The doors follow in this order: the top doors of the
+ * first row, and then for every row, the left door of its first room followed
+ * by the right and bottom doors of every room from left to right.
+ *
+ * Mazes are encoded and decoded one row at a time, so memory use only depends
+ * on the width of the maze.
+ */
+#define MAZE_CODEC_VERSION 1
+
+/**
+ * The size of the stream header.
+ */
+#define MAZE_CODEC_HEADER_SIZE 16
+
+/**
+ * Flags for maze_encoder_create.
+ */
+enum {
+    /** Compress the doors with the range coder instead of storing one bit per
+        door */
+    MAZE_CODEC_RANGE = 1 << 0
+};
+
+/**
+ * Writes encoded data.
+ *
+ * @param context
+ *     The user context.
+ * @param buffer
+ *     The data to write.
+ * @param size
+ *     The number of bytes to write.
+ * @return non-zero if all bytes were written
+ */
+typedef int (*MazeCodecWrite)(void *context, const void *buffer, size_t size);
+
+/**
+ * Reads encoded data.
+ *
+ * @param context
+ *     The user context.
+ * @param buffer
+ *     The buffer to fill.
+ * @param size
+ *     The maximum number of bytes to read.
+ * @return the number of bytes read, or 0 at the end of the data
+ */
+typedef size_t (*MazeCodecRead)(void *context, void *buffer, size_t size);
+
+/**
+ * An encoder, which receives the rows of a maze and writes them to a stream.
+ */
+typedef struct MazeEncoder MazeEncoder;
+
+/**
+ * A decoder, which reads a stream and produces the rows of a maze.
+ */
+typedef struct MazeDecoder MazeDecoder;
+
+/**
+ * Creates an encoder and writes the stream header.
+ *
+ * @param width, height
+ *     The dimensions of the maze to encode.
+ * @param flags
+ *     A combination of the MAZE_CODEC_* flags.
+ * @param write
+ *     The function used to write encoded data.
+ * @param context
+ *     The user context passed to write.
+ * @return a new encoder, or NULL if memory could not be allocated, the
+ *     dimensions are invalid or the header could not be written
+ */
+MazeEncoder*
+maze_encoder_create(unsigned int width, unsigned int height,
+    unsigned int flags, MazeCodecWrite write, void *context);
+
+/**
+ * Encodes the next row of a maze.
+ *
+ * The rows must be passed in order from the top, and the doors between them
+ * must match; the top doors of a row are taken from the bottom doors of the
+ * previous row.
+ *
+ * @param encoder
+ *     The encoder.
+ * @param walls
+ *     The width room values of the row.
+ * @return non-zero unless all rows have already been encoded or writing
+ *     failed
+ */
+int
+maze_encoder_row(MazeEncoder *encoder, const unsigned char *walls);
+
+/**
+ * Writes any remaining data after the last row has been encoded.
+ *
+ * @param encoder
+ *     The encoder.
+ * @return non-zero if all rows were encoded and written successfully
+ */
+int
+maze_encoder_finish(MazeEncoder *encoder);
+
+/**
+ * Frees all resources allocated by an encoder.
+ *
+ * @param encoder
+ *     The encoder to release.
+ */
+void
+maze_encoder_free(MazeEncoder *encoder);
+
+/**
+ * Creates a decoder and reads the stream header.
+ *
+ * @param read
+ *     The function used to read encoded data.
+ * @param context
+ *     The user context passed to read.
+ * @param width, height
+ *     Receive the dimensions of the encoded maze.
+ * @return a new decoder, or NULL if memory could not be allocated or the
+ *     header is not valid
+ */
+MazeDecoder*
+maze_decoder_create(MazeCodecRead read, void *context, unsigned int *width,
+    unsigned int *height);
+
+/**
+ * Decodes the next row of a maze.
+ *
+ * @param decoder
+ *     The decoder.
+ * @param walls
+ *     Receives the width room values of the row.
+ * @return non-zero unless all rows have already been decoded or the stream
+ *     ended early
+ */
+int
+maze_decoder_row(MazeDecoder *decoder, unsigned char *walls);
+
+/**
+ * Frees all resources allocated by a decoder.
+ *
+ * @param decoder
+ *     The decoder to release.
+ */
+void
+maze_decoder_free(MazeDecoder *decoder);
+
+/**
+ * Encodes a complete maze.
+ *
+ * @param maze
+ *     The maze to encode.
+ * @param flags
+ *     A combination of the MAZE_CODEC_* flags.
+ * @param write
+ *     The function used to write encoded data.
+ * @param context
+ *     The user context passed to write.
+ * @return non-zero if the maze was written successfully
+ */
+int
+maze_encode(Maze *maze, unsigned int flags, MazeCodecWrite write,
+    void *context);
+
+/**
+ * Decodes a complete maze.
+ *
+ * @param read
+ *     The function used to read encoded data.
+ * @param context
+ *     The user context passed to read.
+ * @param options
+ *     The options used to create the maze. This may be NULL.
+ * @return a new maze, or NULL if memory could not be allocated or the stream
+ *     is not valid
+ */
+Maze*
+maze_decode(MazeCodecRead read, void *context,
+    const MazeCreateOptions *options);
+
+#endif
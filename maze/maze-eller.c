@@ -0,0 +1,122 @@
+#include <stdlib.h>
+
+#include "maze.h"
+
+/**
+ * A source of single random bits.
+ */
+typedef struct {
+    /** The random number generator */
+    MazeRandom *random;
+
+    /** The bits not yet used */
+    uint64_t bits;
+
+    /** The number of bits left in bits */
+    unsigned int count;
+} Bits;
+
+/**
+ * Retrieves a random bit.
+ *
+ * @param bits
+ *     The bit source.
+ * @return 0 or 1
+ */
+static inline unsigned int
+bit_next(Bits *bits)
+{
+    unsigned int result;
+
+    if (bits->count == 0) {
+        bits->bits = maze_random_next(bits->random);
+        bits->count = 64;
+    }
+
+    result = bits->bits & 1;
+    bits->bits >>= 1;
+    bits->count--;
+
+    return result;
+}
+
+int
+maze_stream_eller(unsigned int width, uint64_t height, MazeRandom *random,
+    MazeRowCallback callback, void *context)
+{
+    unsigned int *left, *right;
+    unsigned char *walls;
+    unsigned int x;
+    uint64_t y;
+    Bits bits = {random, 0, 0};
+    int result = 1;
+
+    if (width == 0 || height == 0) {
+        return 1;
+    }
+
+    /* The cells of a set form a circular list sorted by column; since sets
+       never cross, two adjacent cells are in the same set exactly when one
+       follows the other in the list */
+    left = malloc(sizeof(unsigned int) * width);
+    right = malloc(sizeof(unsigned int) * width);
+    walls = calloc(width, 1);
+    if (!left || !right || !walls) {
+        free(left);
+        free(right);
+        free(walls);
+        return 0;
+    }
+    for (x = 0; x < width; x++) {
+        left[x] = right[x] = x;
+    }
+
+    for (y = 0; y < height; y++) {
+        int last = y == height - 1;
+
+        for (x = 0; x < width; x++) {
+            /* Join the cell to the right if it belongs to another set; on the
+               last row, every set must be joined */
+            if (x + 1 < width && right[x] != x + 1
+                    && (last || bit_next(&bits))) {
+                right[left[x + 1]] = right[x];
+                left[right[x]] = left[x + 1];
+                right[x] = x + 1;
+                left[x + 1] = x;
+
+                walls[x] |= MAZE_WALL_RIGHT;
+                walls[x + 1] |= MAZE_WALL_LEFT;
+            }
+
+            /* Keep the door down closed only if another cell of the set will
+               carry it to the next row */
+            if (last) {
+                continue;
+            }
+            if (right[x] != x && bit_next(&bits)) {
+                left[right[x]] = left[x];
+                right[left[x]] = right[x];
+                left[x] = right[x] = x;
+            }
+            else {
+                walls[x] |= MAZE_WALL_DOWN;
+            }
+        }
+
+        if (!callback(context, y, walls, width)) {
+            result = 0;
+            break;
+        }
+
+        /* The next row starts with the doors down of this row */
+        for (x = 0; x < width; x++) {
+            walls[x] = walls[x] & MAZE_WALL_DOWN ? MAZE_WALL_UP : 0;
+        }
+    }
+
+    free(left);
+    free(right);
+    free(walls);
+
+    return result;
+}
@@ -0,0 +1,99 @@
+#ifndef MAZE_FIELD_H
+#define MAZE_FIELD_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "maze.h"
+
+/**
+ * The distance of a room from which the target cannot be reached.
+ */
+#define MAZE_FIELD_UNREACHABLE UINT32_MAX
+
+/**
+ * Calculates the distance from every room to a target room.
+ *
+ * This is the same as maze_flow_field without a direction field, using one
+ * thread per online processor.
+ *
+ * @param maze
+ *     The maze.
+ * @param tx, ty
+ *     The coordinates of the target room. This must be within the maze.
+ * @param distances
+ *     Receives the distances; it must hold width * height values, and the
+ *     distance of the room at (x, y) is stored at y * width + x.
+ * @return non-zero unless the target lies outside of the maze, the maze has
+ *     2^32 rooms or more, or memory could not be allocated
+ * @see maze_flow_field
+ */
+int
+maze_distance_field(Maze *maze, int tx, int ty, uint32_t *distances);
+
+/**
+ * Calculates the distance from every room to a target room, and the direction
+ * to move in from every room to get closer to it.
+ *
+ * This is meant for many agents moving towards the same target; once the
+ * field is calculated, the next move of every agent is a single lookup.
+ *
+ * The field is calculated by a breadth first search that expands the rooms at
+ * one distance at a time. Large distance levels, as found in mazes with
+ * loops or open areas, are split between threads; a perfect maze rarely has
+ * enough rooms at one distance to make that worthwhile, so it is searched by
+ * the calling thread only. The result does not depend on the number of
+ * threads.
+ *
+ * Doors leading out of the maze are ignored.
+ *
+ * @param maze
+ *     The maze.
+ * @param tx, ty
+ *     The coordinates of the target room. This must be within the maze.
+ * @param distances
+ *     Receives the number of steps from every room to the target, or
+ *     MAZE_FIELD_UNREACHABLE for rooms not connected to it. It must hold
+ *     width * height values, and the distance of the room at (x, y) is stored
+ *     at y * width + x.
+ * @param directions
+ *     Receives the first step from every room towards the target, as one of
+ *     the MAZE_WALL_* values, or 0 for the target and unreachable rooms. It is
+ *     indexed like distances. This may be NULL.
+ * @param threads
+ *     The maximum number of threads to use. If this is 0, one thread per
+ *     online processor is used.
+ * @return non-zero unless the target lies outside of the maze, the maze has
+ *     2^32 rooms or more, or memory could not be allocated
+ */
+int
+maze_flow_field(Maze *maze, int tx, int ty, uint32_t *distances,
+    unsigned char *directions, unsigned int threads);
+
+/**
+ * Updates a field after a door has been opened with maze_door_open.
+ *
+ * Opening a door can only make rooms closer to the target, so only the rooms
+ * that get closer are visited; this is much faster than recalculating the
+ * field when the door is a shortcut for a small part of the maze only.
+ *
+ * Closing doors is not supported; recalculate the field instead.
+ *
+ * @param maze
+ *     The maze, with the door already opened.
+ * @param distances
+ *     The distances to update.
+ * @param directions
+ *     The directions to update. This may be NULL.
+ * @param x, y
+ *     The coordinates of the room whose door was opened.
+ * @param wall
+ *     The door that was opened.
+ * @return non-zero unless memory could not be allocated, in which case the
+ *     field must be recalculated
+ */
+int
+maze_flow_field_update(Maze *maze, uint32_t *distances,
+    unsigned char *directions, int x, int y, unsigned char wall);
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef MAZE_FILE_H
+#define MAZE_FILE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "maze.h"
+
+/**
+ * The version of the file format written by maze_save.
+ *
+ * A file starts with a header of MAZE_FILE_HEADER_SIZE bytes, followed
+ * directly by the walls array of the maze, including the edge rooms, in the
+ * layout of the maze. All numbers in the header are little endian:
+ *
+ *  offset  size  field
+ *       0     8  the magic bytes "MAZE\r\n\032\n"
+ *       8     4  the version
+ *      12     4  the layout, one of the MazeLayout constants
+ *      16     4  the width
+ *      20     4  the height
+ *      24     4  the generator, one of the MAZE_GENERATOR_ID_* constants
+ *      28     4  reserved, 0
+ *      32     8  the seed
+ *      40     8  the size of the walls array
+ *      48    16  reserved, 0
+ *
+ * Room data is not stored.
+ */
+#define MAZE_FILE_VERSION 1
+
+/**
+ * The size of the file header. The walls array follows it directly, so that it
+ * is suitably aligned in a memory mapping of the file.
+ */
+#define MAZE_FILE_HEADER_SIZE 64
+
+/**
+ * The information about how a maze was generated stored in a file.
+ */
+typedef struct {
+    /** The identifier of the generator, or 0 if unknown */
+    unsigned int generator_id;
+
+    /** The seed used to generate the maze */
+    uint64_t seed;
+} MazeFileInfo;
+
+/**
+ * Writes a maze to a file.
+ *
+ * @param maze
+ *     The maze to save.
+ * @param path
+ *     The file to write. An existing file is overwritten.
+ * @param info
+ *     The generator and seed to store. This may be NULL, in which case 0 is
+ *     stored for both.
+ * @return non-zero if the file was written successfully
+ */
+int
+maze_save(Maze *maze, const char *path, const MazeFileInfo *info);
+
+/**
+ * Maps a file written by maze_save into memory.
+ *
+ * The walls array of the returned maze points directly into a read-only shared
+ * mapping of the file, so rooms are only read from disk when first accessed.
+ * The maze must not be modified with maze_door_open or maze_edge_update, but
+ * room data may be set since it is kept in memory. Release it with maze_free.
+ *
+ * @param path
+ *     The file to map.
+ * @param info
+ *     Receives the generator and seed stored in the file. This may be NULL.
+ * @return a read-only maze, or NULL if the file could not be opened or mapped,
+ *     or is not a valid maze file of a supported version
+ */
+Maze*
+maze_map(const char *path, MazeFileInfo *info);
+
+#endif
@@ -0,0 +1,236 @@
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "maze.h"
+
+/**
+ * The number of rooms added by every step of maze_generator_step_time.
+ */
+#define TIME_STEP_ROOMS 1024
+
+struct MazeGenerator {
+    /** The algorithm */
+    const MazeGeneratorType *type;
+
+    /** The maze being initialised */
+    Maze *maze;
+
+    /** The random number generator used if none was passed in the options */
+    MazeRandom random;
+
+    /** The options used */
+    MazeInitializeOptions options;
+
+    /** The state of the algorithm, or NULL if the algorithm cannot be run
+        incrementally or the maze is complete */
+    void *state;
+
+    /** The number of rooms added, and the number of rooms to add */
+    size_t rooms, total;
+
+    /** Whether the maze is complete, or no more rooms will be added because
+        the algorithm failed */
+    int complete;
+
+    /** Whether the algorithm failed */
+    int failed;
+};
+
+/**
+ * Returns the current time.
+ *
+ * @return a monotonic time in seconds
+ */
+static double
+now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+/**
+ * All built-in generators.
+ */
+static const MazeGeneratorType *TYPES[] = {
+    &MAZE_GENERATOR_RANDOMIZED_PRIM,
+    &MAZE_GENERATOR_KRUSKAL,
+    &MAZE_GENERATOR_BACKTRACKER,
+    &MAZE_GENERATOR_WILSON,
+    &MAZE_GENERATOR_BINARY_TREE,
+    &MAZE_GENERATOR_SIDEWINDER,
+    NULL
+};
+
+const MazeGeneratorType*
+maze_generator_type_find(const char *name)
+{
+    const MazeGeneratorType **type;
+
+    for (type = TYPES; *type; type++) {
+        if (strcmp((*type)->name, name) == 0) {
+            return *type;
+        }
+    }
+
+    return NULL;
+}
+
+const MazeGeneratorType*
+maze_generator_type_get(unsigned int id)
+{
+    const MazeGeneratorType **type;
+
+    for (type = TYPES; *type; type++) {
+        if ((*type)->id == id) {
+            return *type;
+        }
+    }
+
+    return NULL;
+}
+
+int
+maze_initialize(Maze *maze, const MazeGeneratorType *type,
+    const MazeInitializeOptions *options)
+{
+    static const MazeInitializeOptions defaults = {NULL, NULL, NULL};
+    MazeRandom random;
+
+    if (!options) {
+        options = &defaults;
+    }
+
+    /* Behave like the original generators if no generator is specified */
+    if (!options->random) {
+        maze_random_seed(&random, ((uint64_t)rand() << 32) ^ rand());
+    }
+
+    return type->initialize_region(maze,
+        options->random ? options->random : &random,
+        0, 0, maze->width, maze->height, options->callback, options->context);
+}
+
+MazeGenerator*
+maze_generator_begin(Maze *maze, const MazeGeneratorType *type,
+    const MazeInitializeOptions *options)
+{
+    static const MazeInitializeOptions defaults = {NULL, NULL, NULL};
+    MazeGenerator *result;
+
+    result = malloc(sizeof(MazeGenerator));
+    if (!result) {
+        return NULL;
+    }
+
+    result->type = type;
+    result->maze = maze;
+    result->options = options ? *options : defaults;
+    if (!result->options.random) {
+        maze_random_seed(&result->random, ((uint64_t)rand() << 32) ^ rand());
+        result->options.random = &result->random;
+    }
+    result->state = NULL;
+    result->rooms = 0;
+    result->total = (size_t)maze->width * maze->height;
+    result->complete = result->total == 0;
+    result->failed = 0;
+
+    /* The start room is added by begin */
+    if (type->begin && !result->complete) {
+        result->state = type->begin(maze, result->options.random,
+            0, 0, maze->width, maze->height,
+            result->options.callback, result->options.context);
+        if (!result->state) {
+            free(result);
+            return NULL;
+        }
+        result->rooms = 1;
+    }
+
+    return result;
+}
+
+int
+maze_generator_step(MazeGenerator *generator, unsigned int max_rooms)
+{
+    if (generator->complete) {
+        return 0;
+    }
+
+    if (generator->state) {
+        if (!generator->type->step(generator->state, max_rooms,
+                &generator->rooms)) {
+            generator->type->end(generator->state);
+            generator->state = NULL;
+            generator->complete = 1;
+        }
+    }
+    else {
+        generator->failed = !generator->type->initialize_region(
+            generator->maze, generator->options.random, 0, 0,
+            generator->maze->width, generator->maze->height,
+            generator->options.callback, generator->options.context);
+        generator->complete = 1;
+    }
+
+    /* A failed maze keeps reporting the progress it had */
+    if (generator->complete && !generator->failed) {
+        generator->rooms = generator->total;
+    }
+
+    return !generator->complete;
+}
+
+int
+maze_generator_step_time(MazeGenerator *generator, double seconds)
+{
+    double end = now() + seconds;
+
+    while (maze_generator_step(generator, TIME_STEP_ROOMS)) {
+        if (now() >= end) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+double
+maze_generator_progress(MazeGenerator *generator)
+{
+    return generator->total
+        ? (double)generator->rooms / generator->total
+        : 1.0;
+}
+
+int
+maze_generator_failed(MazeGenerator *generator)
+{
+    return generator->failed;
+}
+
+int
+maze_generator_finish(MazeGenerator *generator)
+{
+    int result;
+
+    while (maze_generator_step(generator, UINT_MAX));
+    result = !generator->failed;
+    maze_generator_free(generator);
+
+    return result;
+}
+
+void
+maze_generator_free(MazeGenerator *generator)
+{
+    if (generator->state) {
+        generator->type->end(generator->state);
+    }
+    free(generator);
+}
@@ -0,0 +1,186 @@
+#ifndef MAZE_GRAPH_H
+#define MAZE_GRAPH_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "maze.h"
+
+/**
+ * The node index returned for rooms that are not nodes.
+ */
+#define MAZE_GRAPH_NONE UINT32_MAX
+
+/**
+ * A maze with its corridors collapsed into weighted edges.
+ *
+ * Most rooms of a maze have exactly two doors, and only lead from one room
+ * to the next. The nodes of the graph are the other rooms: junctions, dead
+ * ends and rooms without doors. A corridor of rooms with two doors between
+ * two nodes becomes an edge whose length is the number of steps along it.
+ * A loop of rooms with two doors only gets one of its rooms as a node.
+ *
+ * The edges are stored in compressed sparse row form: the edges leaving node
+ * n are those from offsets[n] up to, but not including, offsets[n + 1]. Every
+ * corridor is stored once from each end.
+ *
+ * The rooms inside a corridor are not stored; a route is expanded into rooms
+ * by walking the maze, and only when asked for. The graph is a copy; it is
+ * not updated when the maze changes. Doors leading out of the maze are
+ * ignored.
+ */
+typedef struct {
+    /** The dimensions of the maze */
+    unsigned int width, height;
+
+    /** The number of nodes */
+    size_t node_count;
+
+    /** The room of every node as y * width + x, in ascending order */
+    uint32_t *rooms;
+
+    /** The first edge of every node; this has node_count + 1 entries */
+    uint32_t *offsets;
+
+    /** The node every edge leads to */
+    uint32_t *targets;
+
+    /** The number of steps along every edge */
+    uint32_t *lengths;
+
+    /** The wall through which every edge leaves its node, as one of the
+        MAZE_WALL_* values */
+    unsigned char *walls;
+
+    /** One bit per room, set for nodes, and the number of nodes before every
+        64 rooms */
+    uint64_t *nodes;
+    uint32_t *ranks;
+} MazeGraph;
+
+/**
+ * The memory used by maze_graph_solve.
+ *
+ * A workspace grows to fit the largest graph and route it has been used for.
+ * It must not be used by several threads at the same time.
+ */
+typedef struct MazeGraphWorkspace MazeGraphWorkspace;
+
+/**
+ * A part of a route that follows a single corridor.
+ */
+typedef struct {
+    /** The wall through which the first room is left */
+    unsigned char wall;
+
+    /** The number of steps */
+    uint32_t length;
+} MazeGraphLeg;
+
+/**
+ * A route through a maze, as a sequence of corridors.
+ */
+typedef struct {
+    /** The number of steps */
+    size_t length;
+
+    /** The corridors followed. This points into the workspace, and is valid
+        until it is used again */
+    size_t leg_count;
+    const MazeGraphLeg *legs;
+} MazeGraphRoute;
+
+/**
+ * Builds the junction graph of a maze.
+ *
+ * @param maze
+ *     The maze. It must have fewer than 2^32 rooms.
+ * @return a new graph, or NULL if the maze is empty, too large, or memory
+ *     could not be allocated
+ */
+MazeGraph*
+maze_graph_create(Maze *maze);
+
+/**
+ * Frees all resources allocated by a graph.
+ *
+ * @param graph
+ *     The graph to release.
+ */
+void
+maze_graph_free(MazeGraph *graph);
+
+/**
+ * Finds the node of a room.
+ *
+ * @param graph
+ *     The graph.
+ * @param x, y
+ *     The coordinates of the room. These must be within the maze.
+ * @return the index of the node, or MAZE_GRAPH_NONE if the room lies inside
+ *     a corridor
+ */
+uint32_t
+maze_graph_node_find(MazeGraph *graph, int x, int y);
+
+/**
+ * Creates an empty workspace.
+ *
+ * @return a new workspace, or NULL if memory could not be allocated
+ */
+MazeGraphWorkspace*
+maze_graph_workspace_create(void);
+
+/**
+ * Frees all resources allocated by a workspace.
+ *
+ * @param workspace
+ *     The workspace to release.
+ */
+void
+maze_graph_workspace_free(MazeGraphWorkspace *workspace);
+
+/**
+ * Finds a shortest route between two rooms.
+ *
+ * The search is an A* search over the nodes, using the Manhattan distance to
+ * the last room as the estimate. Rooms inside corridors are connected to the
+ * nodes at both ends of their corridor by walking the maze.
+ *
+ * @param graph
+ *     The graph of the maze.
+ * @param maze
+ *     The maze. It must not have changed since the graph was built.
+ * @param sx, sy
+ *     The coordinates of the first room. These must be within the maze.
+ * @param tx, ty
+ *     The coordinates of the last room. These must be within the maze.
+ * @param workspace
+ *     The workspace to use.
+ * @param route
+ *     Receives the route. Use maze_graph_route_expand to turn it into steps.
+ * @return non-zero if a route was found, or 0 if the rooms are not connected
+ *     or memory could not be allocated
+ */
+int
+maze_graph_solve(MazeGraph *graph, Maze *maze, int sx, int sy, int tx, int ty,
+    MazeGraphWorkspace *workspace, MazeGraphRoute *route);
+
+/**
+ * Expands a route into the steps between rooms.
+ *
+ * @param maze
+ *     The maze the route was found in.
+ * @param sx, sy
+ *     The coordinates of the first room of the route.
+ * @param route
+ *     The route.
+ * @param steps
+ *     Receives the direction of every step, as one of the MAZE_WALL_* values.
+ *     It must have room for route->length values.
+ */
+void
+maze_graph_route_expand(Maze *maze, int sx, int sy,
+    const MazeGraphRoute *route, unsigned char *steps);
+
+#endif
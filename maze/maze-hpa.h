@@ -0,0 +1,107 @@
+#ifndef MAZE_HPA_H
+#define MAZE_HPA_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "maze.h"
+#include "maze-solve.h"
+
+/**
+ * A hierarchical index for finding paths in large mazes that change.
+ *
+ * The maze is divided into square clusters. Every room with a door leading
+ * into another cluster is an entrance, and for every cluster the index stores
+ * the length of the shortest path within the cluster between all pairs of its
+ * entrances. A search runs over the entrances only, stepping through a cluster
+ * in one go, and is then refined into rooms by searching within the clusters
+ * along the way. Since every door between clusters is an entrance, the paths
+ * found are shortest paths.
+ *
+ * After doors have been opened, maze_hpa_update marks the clusters they touch;
+ * these are rebuilt by the next search, and all other clusters are kept.
+ *
+ * An index must not be used by several threads at the same time. Doors
+ * leading out of the maze are ignored.
+ */
+typedef struct MazeHpa MazeHpa;
+
+/**
+ * Creates the index of a maze.
+ *
+ * The clusters are built by the first search.
+ *
+ * @param maze
+ *     The maze. It must outlive the index, and must have fewer than 2^32
+ *     rooms.
+ * @param cluster_size
+ *     The width and height of a cluster, at most 255. Smaller clusters are
+ *     faster to rebuild, and larger ones make searches faster. If this is 0,
+ *     a default is used.
+ * @return a new index, or NULL if the maze is empty, too large, or memory
+ *     could not be allocated
+ */
+MazeHpa*
+maze_hpa_create(Maze *maze, unsigned int cluster_size);
+
+/**
+ * Frees all resources allocated by an index.
+ *
+ * @param hpa
+ *     The index to release.
+ */
+void
+maze_hpa_free(MazeHpa *hpa);
+
+/**
+ * Marks the clusters touched by a door that has been opened with
+ * maze_door_open, so that they are rebuilt by the next search.
+ *
+ * @param hpa
+ *     The index.
+ * @param x, y
+ *     The coordinates of the room whose door was opened.
+ * @param wall
+ *     The door that was opened.
+ */
+void
+maze_hpa_update(MazeHpa *hpa, int x, int y, unsigned char wall);
+
+/**
+ * Calculates the length of a shortest path between two rooms, without
+ * refining it into steps.
+ *
+ * @param hpa
+ *     The index.
+ * @param sx, sy
+ *     The coordinates of the first room. These must be within the maze.
+ * @param tx, ty
+ *     The coordinates of the last room. These must be within the maze.
+ * @param length
+ *     Receives the number of steps.
+ * @return non-zero if a path was found, or 0 if the rooms are not connected
+ *     or memory could not be allocated
+ */
+int
+maze_hpa_distance(MazeHpa *hpa, int sx, int sy, int tx, int ty,
+    size_t *length);
+
+/**
+ * Finds a shortest path between two rooms.
+ *
+ * @param hpa
+ *     The index.
+ * @param sx, sy
+ *     The coordinates of the first room. These must be within the maze.
+ * @param tx, ty
+ *     The coordinates of the last room. These must be within the maze.
+ * @param path
+ *     Receives the path. Its steps point into the index, and are valid until
+ *     it is used again.
+ * @return non-zero if a path was found, or 0 if the rooms are not connected
+ *     or memory could not be allocated
+ */
+int
+maze_hpa_solve(MazeHpa *hpa, int sx, int sy, int tx, int ty, MazePath *path);
+
+#endif
@@ -0,0 +1,187 @@
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "maze.h"
+
+/**
+ * The direction bit of an edge; an edge is the index of a room shifted left
+ * once, with this bit set if it is the door down and cleared if it is the door
+ * to the right.
+ */
+#define EDGE_DOWN 1
+
+/**
+ * The maximum number of rooms in an area, since an edge stores the index of a
+ * room in 31 bits. Larger mazes can be initialised in tiles.
+ */
+#define MAX_ROOMS ((uint64_t)1 << 31)
+
+/**
+ * A disjoint set forest with one item per room.
+ */
+typedef struct {
+    /** The parent of every item; a root is its own parent */
+    uint32_t *parent;
+
+    /** The rank of every root */
+    unsigned char *rank;
+} DisjointSet;
+
+/**
+ * Finds the root of the set containing an item.
+ *
+ * Every item visited is moved closer to the root.
+ *
+ * @param set
+ *     The disjoint set forest.
+ * @param item
+ *     The item.
+ * @return the root item
+ */
+static inline uint32_t
+set_find(DisjointSet *set, uint32_t item)
+{
+    while (set->parent[item] != item) {
+        set->parent[item] = set->parent[set->parent[item]];
+        item = set->parent[item];
+    }
+
+    return item;
+}
+
+/**
+ * Joins the sets containing two items.
+ *
+ * @param set
+ *     The disjoint set forest.
+ * @param a, b
+ *     The items.
+ * @return non-zero if the items were in different sets
+ */
+static inline int
+set_join(DisjointSet *set, uint32_t a, uint32_t b)
+{
+    a = set_find(set, a);
+    b = set_find(set, b);
+    if (a == b) {
+        return 0;
+    }
+
+    /* Attach the shallower tree to the deeper */
+    if (set->rank[a] < set->rank[b]) {
+        set->parent[a] = b;
+    }
+    else if (set->rank[a] > set->rank[b]) {
+        set->parent[b] = a;
+    }
+    else {
+        set->parent[b] = a;
+        set->rank[a]++;
+    }
+
+    return 1;
+}
+
+void
+maze_initialize_kruskal(Maze *maze, MazeInitializeCallback callback,
+    void *context)
+{
+    MazeRandom random;
+
+    maze_random_seed(&random, ((uint64_t)rand() << 32) ^ rand());
+    maze_initialize_kruskal_r(maze, &random, callback, context);
+}
+
+void
+maze_initialize_kruskal_r(Maze *maze, MazeRandom *random,
+    MazeInitializeCallback callback, void *context)
+{
+    maze_initialize_kruskal_region(maze, random, 0, 0,
+        maze->width, maze->height, callback, context);
+}
+
+int
+maze_initialize_kruskal_region(Maze *maze, MazeRandom *random,
+    int x, int y, unsigned int width, unsigned int height,
+    MazeInitializeCallback callback, void *context)
+{
+    DisjointSet set;
+    uint32_t *edges;
+    uint32_t rooms, count, remaining, i;
+
+    if (width == 0 || height == 0 || !maze_contains(maze, x, y)
+            || !maze_contains(maze, x + width - 1, y + height - 1)) {
+        return 1;
+    }
+    if ((uint64_t)width * height > MAX_ROOMS) {
+        return 0;
+    }
+
+    rooms = width * height;
+    count = width * (height - 1) + height * (width - 1);
+    edges = malloc(sizeof(uint32_t) * (count ? count : 1));
+    set.parent = malloc(sizeof(uint32_t) * rooms);
+    set.rank = calloc(rooms, 1);
+    if (!edges || !set.parent || !set.rank) {
+        free(edges);
+        free(set.parent);
+        free(set.rank);
+        return 0;
+    }
+
+    /* Create every edge between two rooms and shuffle them in the same pass */
+    count = 0;
+    for (i = 0; i < rooms; i++) {
+        set.parent[i] = i;
+        if (i % width < width - 1) {
+            uint32_t j = maze_random_range(random, count + 1);
+
+            edges[count++] = edges[j];
+            edges[j] = i << 1;
+        }
+        if (i / width < height - 1) {
+            uint32_t j = maze_random_range(random, count + 1);
+
+            edges[count++] = edges[j];
+            edges[j] = (i << 1) | EDGE_DOWN;
+        }
+    }
+
+    /* Open the door of every edge that joins two separate sets, and stop as
+       soon as all rooms belong to the same set */
+    remaining = rooms - 1;
+    for (i = 0; i < count && remaining; i++) {
+        uint32_t room = edges[i] >> 1;
+        uint32_t other = edges[i] & EDGE_DOWN ? room + width : room + 1;
+
+        if (set_join(&set, room, other)) {
+            maze_door_open(maze, x + room % width, y + room / width,
+                edges[i] & EDGE_DOWN ? MAZE_WALL_DOWN : MAZE_WALL_RIGHT);
+            remaining--;
+        }
+    }
+
+    free(edges);
+    free(set.parent);
+    free(set.rank);
+
+    if (callback) {
+        for (i = 0; i < rooms; i++) {
+            int rx = x + i % width, ry = y + i / width;
+
+            maze_data_set(maze, rx, ry,
+                callback(context, maze, rx, ry, NULL));
+        }
+    }
+
+    return 1;
+}
+
+const MazeGeneratorType MAZE_GENERATOR_KRUSKAL = {
+    MAZE_GENERATOR_ID_KRUSKAL,
+    "kruskal",
+    maze_initialize_kruskal_region,
+    NULL,
+    NULL,
+    NULL
+};
@@ -0,0 +1,163 @@
+#ifndef MAZE_RANDOM_H
+#define MAZE_RANDOM_H
+
+#include <stdint.h>
+
+/**
+ * The state of a random number generator.
+ *
+ * This is the xoshiro256** generator. It is fast, has a period of 2^256 - 1
+ * and supports jumping ahead, which makes it possible to split one seed into
+ * many independent streams.
+ *
+ * A state is not shared between functions, so several states may be used
+ * concurrently from different threads.
+ */
+typedef struct {
+    /** The internal state; this must never be all zeroes */
+    uint64_t state[4];
+} MazeRandom;
+
+/**
+ * Seeds a random number generator.
+ *
+ * The same seed always generates the same sequence of numbers.
+ *
+ * @param random
+ *     The random number generator to seed.
+ * @param seed
+ *     The seed.
+ */
+void
+maze_random_seed(MazeRandom *random, uint64_t seed);
+
+/**
+ * Advances a random number generator by 2^128 steps.
+ *
+ * This is equivalent to 2^128 calls to maze_random_next, and is used to
+ * generate non-overlapping streams for parallel computations: seed one
+ * generator, and create a copy and jump once for every additional stream.
+ *
+ * @param random
+ *     The random number generator to advance.
+ */
+void
+maze_random_jump(MazeRandom *random);
+
+/**
+ * Advances a random number generator by 2^192 steps.
+ *
+ * This is used to generate streams that may in turn be split using
+ * maze_random_jump.
+ *
+ * @param random
+ *     The random number generator to advance.
+ */
+void
+maze_random_long_jump(MazeRandom *random);
+
+/**
+ * Rotates a value left.
+ *
+ * @param value
+ *     The value to rotate.
+ * @param count
+ *     The number of bits to rotate. This must be in the range (0, 64).
+ * @return the rotated value
+ */
+static inline uint64_t
+maze_random_rotl(uint64_t value, int count)
+{
+    return (value << count) | (value >> (64 - count));
+}
+
+/**
+ * Generates a random number.
+ *
+ * @param random
+ *     The random number generator.
+ * @return a random 64 bit number
+ */
+static inline uint64_t
+maze_random_next(MazeRandom *random)
+{
+    uint64_t *s = random->state;
+    uint64_t result = maze_random_rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = maze_random_rotl(s[3], 45);
+
+    return result;
+}
+
+/**
+ * Generates a random number in the range [0, limit).
+ *
+ * The result is unbiased.
+ *
+ * @param random
+ *     The random number generator.
+ * @param limit
+ *     The upper limit. This must not be 0.
+ * @return a random number less than limit
+ */
+static inline uint32_t
+maze_random_range(MazeRandom *random, uint32_t limit)
+{
+    uint64_t product = (maze_random_next(random) >> 32) * limit;
+
+    /* Reject the few values that would make the lower numbers more likely */
+    if ((uint32_t)product < limit) {
+        uint32_t threshold = -limit % limit;
+
+        while ((uint32_t)product < threshold) {
+            product = (maze_random_next(random) >> 32) * limit;
+        }
+    }
+
+    return product >> 32;
+}
+
+/**
+ * Generates a random number in the range [0, limit) for any 64 bit limit.
+ *
+ * The result is unbiased, and is the same as that of maze_random_range for
+ * limits that fit in 32 bits.
+ *
+ * @param random
+ *     The random number generator.
+ * @param limit
+ *     The upper limit. This must not be 0.
+ * @return a random number less than limit
+ */
+static inline uint64_t
+maze_random_range64(MazeRandom *random, uint64_t limit)
+{
+    uint64_t mask = limit - 1;
+    uint64_t value;
+
+    if (limit <= UINT32_MAX) {
+        return maze_random_range(random, (uint32_t)limit);
+    }
+
+    /* Draw from the smallest power of two range containing limit, which
+       rejects fewer than half of the values */
+    mask |= mask >> 1;
+    mask |= mask >> 2;
+    mask |= mask >> 4;
+    mask |= mask >> 8;
+    mask |= mask >> 16;
+    mask |= mask >> 32;
+    do {
+        value = maze_random_next(random) & mask;
+    } while (value >= limit);
+
+    return value;
+}
+
+#endif
@@ -1,129 +1,139 @@
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "maze.h"
 
 /**
- * Calculates the number of RandomizedPrimData in the list.
+ * The frontier used while initialising a maze.
+ */
+typedef struct {
+    /** The public view of the frontier */
+    RandomizedPrimData data;
+
+    /** A bit mask with one bit per room; a bit is set when the room has been
+        added to the maze and its walls have been queued */
+    unsigned char *queued;
+
+    /** The coordinates of the top left room of the area being initialised */
+    int x, y;
+
+    /** The width of the area being initialised */
+    unsigned int width;
+
+    /** The height of the area being initialised */
+    unsigned int height;
+
+    /** The maze being initialised */
+    Maze *maze;
+
+    /** The random number generator */
+    MazeRandom *random;
+
+    /** The callback function and its context */
+    MazeInitializeCallback callback;
+    void *context;
+
+    /** The coordinates of the start room */
+    int start_x, start_y;
+} Frontier;
+
+/**
+ * Determines whether the walls of a room have been queued.
  *
- * @param data
- *     A pointer to a list of RandomizedPrimData.
- * @return the number of items in the list
+ * @param frontier
+ *     The frontier.
+ * @param x, y
+ *     The coordinates of the room.
+ * @return non-zero if the room has been queued
  */
-static inline unsigned int
-wall_count(RandomizedPrimData **data)
+static inline int
+room_is_queued(Frontier *frontier, int x, int y)
 {
-    unsigned int count;
-    RandomizedPrimData *p;
+    size_t index = (size_t)(y - frontier->y) * frontier->width
+        + (x - frontier->x);
 
-    for (count = 0, p = *data;
-        p;
-        count++, p = p->next);
-
-    return count;
+    return frontier->queued[index / 8] & (1 << (index % 8));
 }
 
 /**
- * Picks a random wall from the list.
+ * Picks a random wall from the frontier.
  *
- * The wall returned is removed from the list.
+ * The wall is removed by moving the last item of the frontier into its slot.
  *
- * @param data
- *     A pointer to a list of RandomizedPrimData.
- * @return an item that must be freed, or NULL if the list is empty
+ * @param frontier
+ *     The frontier.
+ * @param random
+ *     The random number generator.
+ * @param wall
+ *     The wall picked. This is only modified if the frontier is not empty.
+ * @return whether a wall was picked
  */
-static inline RandomizedPrimData*
-wall_pick(RandomizedPrimData **data)
+static inline int
+wall_pick(Frontier *frontier, MazeRandom *random, RandomizedPrimWall *wall)
 {
-    unsigned int count, index;
-
-    /* We cannot pick from an empty wall list */
-    if (!*data) {
-        return NULL;
-    }
-
-    /* Select a random item in the list by index */
-    count = wall_count(data);
-    index = rand() % count;
-
-    if (index == 0) {
-        /* If we remove the first item, we just have to change *data */
-        RandomizedPrimData *result = *data;
+    size_t index;
 
-        *data = (*data)->next;
-
-        return result;
+    /* We cannot pick from an empty frontier */
+    if (frontier->data.count == 0) {
+        return 0;
     }
-    else {
-        RandomizedPrimData *previous;
-        RandomizedPrimData *result;
-
-        /* Find the item before the index'th item */
-        index--;
-        for (previous = *data;
-            index;
-            index--, previous = previous->next);
 
-        result = previous->next;
-        previous->next = previous->next->next;
+    index = maze_random_range64(random, frontier->data.count);
+    *wall = frontier->data.walls[index];
+    frontier->data.walls[index] = frontier->data.walls[--frontier->data.count];
 
-        return result;
-    }
+    return 1;
 }
 
 /**
- * Adds all valid walls of the room at (x, y) that are not already in the list.
+ * Marks the room at (x, y) as queued and adds all walls leading to rooms that
+ * have not yet been queued.
  *
- * All walls that are not on the edge of the maze are valid.
+ * Since a wall is only added if the room on the other side is not queued, every
+ * wall is added at most once.
  *
- * @param data
- *     A pointer to a list of RandomizedPrimData.
- * @param x
- *     The x coordinate of the room.
- * @param y
- *     The y coordinate of the room.
- * @param width
- *     The width of the maze.
- * @param height
- *     The height of the maze.
+ * @param frontier
+ *     The frontier.
+ * @param x, y
+ *     The coordinates of the room.
  */
 static inline void
-wall_add_all_new(RandomizedPrimData **data, int x, int y,
-    unsigned int width, unsigned int height)
+wall_add_all_new(Frontier *frontier, int x, int y)
 {
-    unsigned int walls;
-    RandomizedPrimData *p;
+    size_t index = (size_t)(y - frontier->y) * frontier->width
+        + (x - frontier->x);
     unsigned int wall;
 
-    /* Only try those walls that are valid */
-    walls = 0
-        | (x > 0
-            ? MAZE_WALL_LEFT : 0)
-        | (y > 0
-            ? MAZE_WALL_UP : 0)
-        | (x < width - 1
-            ? MAZE_WALL_RIGHT : 0)
-        | (y < height - 1
-            ? MAZE_WALL_DOWN : 0);
-
-    /* Remove any wall already present in the list */
-    for (p = *data; p; p = p->next) {
-        if (p->x == x && p->y == y) {
-            walls &= ~p->wall;
-        }
-    }
+    frontier->queued[index / 8] |= 1 << (index % 8);
 
-    /* Add all remaining walls */
     for (wall = 1; wall & MAZE_WALL_ANY; wall <<= 1) {
-        if (wall & walls) {
-            RandomizedPrimData *current = malloc(sizeof(RandomizedPrimData));
-
-            current->x = x;
-            current->y = y;
-            current->wall = wall;
-            current->next = *data;
-            *data = current;
+        int nx = x, ny = y;
+
+        if (wall & MAZE_WALL_LEFT) {
+            nx--;
+        }
+        else if (wall & MAZE_WALL_UP) {
+            ny--;
+        }
+        else if (wall & MAZE_WALL_RIGHT) {
+            nx++;
+        }
+        else {
+            ny++;
         }
+
+        /* Only try those walls that lead to new rooms within the area */
+        if (nx < frontier->x || nx >= frontier->x + (int)frontier->width
+                || ny < frontier->y || ny >= frontier->y + (int)frontier->height
+                || room_is_queued(frontier, nx, ny)) {
+            continue;
+        }
+
+        frontier->data.walls[frontier->data.count].x = x;
+        frontier->data.walls[frontier->data.count].y = y;
+        frontier->data.walls[frontier->data.count].wall = wall;
+        frontier->data.count++;
     }
 }
 
@@ -131,39 +141,159 @@ void
 maze_initialize_randomized_prim(Maze *maze, MazeInitializeCallback callback,
     void *context)
 {
-    RandomizedPrimData *walls, *wall;
-    int start_x, start_y;
+    MazeRandom random;
+
+    maze_random_seed(&random, ((uint64_t)rand() << 32) ^ rand());
+    maze_initialize_randomized_prim_r(maze, &random, callback, context);
+}
+
+void
+maze_initialize_randomized_prim_r(Maze *maze, MazeRandom *random,
+    MazeInitializeCallback callback, void *context)
+{
+    maze_initialize_randomized_prim_region(maze, random, 0, 0,
+        maze->width, maze->height, callback, context);
+}
+
+/**
+ * Starts initialising a rectangular area of the maze.
+ *
+ * @see MazeGeneratorType.begin
+ */
+static void*
+begin(Maze *maze, MazeRandom *random,
+    int x, int y, unsigned int width, unsigned int height,
+    MazeInitializeCallback callback, void *context)
+{
+    Frontier *frontier;
+    size_t rooms = (size_t)width * height;
+    size_t capacity;
+
+    frontier = malloc(sizeof(Frontier));
+    if (!frontier) {
+        return NULL;
+    }
+
+    /* Every wall between two rooms is added at most once */
+    capacity = 2 * rooms - width - height;
+    frontier->x = x;
+    frontier->y = y;
+    frontier->width = width;
+    frontier->height = height;
+    frontier->maze = maze;
+    frontier->random = random;
+    frontier->callback = callback;
+    frontier->context = context;
+    frontier->data.count = 0;
+    frontier->data.walls = malloc(
+        sizeof(RandomizedPrimWall) * (capacity ? capacity : 1));
+    frontier->queued = calloc(rooms / 8 + 1, 1);
+    if (!frontier->data.walls || !frontier->queued) {
+        free(frontier->data.walls);
+        free(frontier->queued);
+        free(frontier);
+        return NULL;
+    }
 
     /* Start with a random room and add its walls */
-    start_x = rand() % maze->width;
-    start_y = rand() % maze->height;
-    walls = NULL;
-    wall_add_all_new(&walls, start_x, start_y, maze->width, maze->height);
+    frontier->start_x = x + maze_random_range(random, width);
+    frontier->start_y = y + maze_random_range(random, height);
+    wall_add_all_new(frontier, frontier->start_x, frontier->start_y);
+
+    return frontier;
+}
+
+/**
+ * Picks walls from the frontier and opens those leading to new rooms.
+ *
+ * @see MazeGeneratorType.step
+ */
+static int
+step(void *state, unsigned int max_rooms, size_t *rooms)
+{
+    Frontier *frontier = state;
+    Maze *maze = frontier->maze;
+    RandomizedPrimWall wall;
+    unsigned int picked;
+
+    for (picked = 0; picked < max_rooms; picked++) {
+        int nx, ny;
 
-    /* Mark the room as part of the maze */
-    maze_data_set(maze, start_x, start_y, (void*)1);
+        if (!wall_pick(frontier, frontier->random, &wall)) {
+            /* Set the data of the start room */
+            maze_data_set(maze, frontier->start_x, frontier->start_y,
+                frontier->callback
+                    ? frontier->callback(frontier->context, maze,
+                        frontier->start_x, frontier->start_y, NULL)
+                    : 0);
 
-    while ((wall = wall_pick(&walls)) != NULL) {
-        int x, y;
+            return 0;
+        }
 
-        x = wall->x;
-        y = wall->y;
-        if (maze_door_enter(maze, &x, &y, wall->wall, 0)
-                && !maze_room_get(maze, x, y)) {
+        nx = wall.x;
+        ny = wall.y;
+        if (maze_door_enter(maze, &nx, &ny, wall.wall, 0)
+                && !room_is_queued(frontier, nx, ny)) {
             /* Only proceed if the room has not been touched before */
-            maze_door_open(maze, wall->x, wall->y, wall->wall);
-            wall_add_all_new(&walls, x, y, maze->width, maze->height);
+            maze_door_open(maze, wall.x, wall.y, wall.wall);
+            wall_add_all_new(frontier, nx, ny);
+            (*rooms)++;
 
-            if (callback) {
-                maze_data_set(maze, x, y, callback(context, maze, x, y, walls));
+            if (frontier->callback) {
+                maze_data_set(maze, nx, ny,
+                    frontier->callback(frontier->context, maze, nx, ny,
+                        &frontier->data));
             }
         }
+    }
+
+    return 1;
+}
+
+/**
+ * Releases the frontier.
+ *
+ * @see MazeGeneratorType.end
+ */
+static void
+end(void *state)
+{
+    Frontier *frontier = state;
 
-        free(wall);
+    free(frontier->data.walls);
+    free(frontier->queued);
+    free(frontier);
+}
+
+int
+maze_initialize_randomized_prim_region(Maze *maze, MazeRandom *random,
+    int x, int y, unsigned int width, unsigned int height,
+    MazeInitializeCallback callback, void *context)
+{
+    void *state;
+    size_t rooms = 0;
+
+    /* An empty area has no start room */
+    if (width == 0 || height == 0 || !maze_contains(maze, x, y)
+            || !maze_contains(maze, x + width - 1, y + height - 1)) {
+        return 1;
+    }
+
+    state = begin(maze, random, x, y, width, height, callback, context);
+    if (!state) {
+        return 0;
     }
+    while (step(state, UINT_MAX, &rooms));
+    end(state);
 
-    /* Set the data of the start room */
-    maze_data_set(maze, start_x, start_y, callback
-        ? callback(context, maze, start_x, start_y, NULL)
-        : 0);
+    return 1;
 }
+
+const MazeGeneratorType MAZE_GENERATOR_RANDOMIZED_PRIM = {
+    MAZE_GENERATOR_ID_RANDOMIZED_PRIM,
+    "randomized-prim",
+    maze_initialize_randomized_prim_region,
+    begin,
+    step,
+    end
+};
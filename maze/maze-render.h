@@ -1,7 +1,45 @@
 #ifndef MAZE_RENDER_H
 #define MAZE_RENDER_H
 
+#include <stdio.h>
+
 #include "maze.h"
+#include "maze-world.h"
+
+/**
+ * Determines whether a part of a room is covered by a wall when the room is
+ * rendered as a grid of cells.
+ *
+ * The outermost cells of a room are walls, except for the cells in the middle
+ * of a side with an open door. The corners are always walls.
+ *
+ * @param walls
+ *     The wall bit mask of the room, as returned by maze_room_get.
+ * @param dx, dy
+ *     The cell within the room.
+ * @param room_width, room_height
+ *     The size of a room in cells.
+ * @return non-zero if the cell is a wall
+ */
+static inline int
+maze_render_is_wall(unsigned char walls, unsigned int dx, unsigned int dy,
+    unsigned int room_width, unsigned int room_height)
+{
+    int is_left = dx == 0;
+    int is_right = dx == room_width - 1;
+
+    if (dy == 0) {
+        return is_left || is_right || !(walls & MAZE_WALL_UP);
+    }
+    else if (dy == room_height - 1) {
+        return is_left || is_right || !(walls & MAZE_WALL_DOWN);
+    }
+    else {
+        return is_left
+            ? !(walls & MAZE_WALL_LEFT)
+            : is_right && !(walls & MAZE_WALL_RIGHT);
+    }
+}
 
 /**
  * Prints a maze to stdout.
@@ -21,6 +59,87 @@ void
 maze_render_print(Maze *maze, unsigned int room_width, unsigned int room_height,
     char wall_char, char floor_char);
 
+/**
+ * The context of maze_render_print_row.
+ */
+typedef struct {
+    /** The stream to which to print */
+    FILE *stream;
+
+    /** The width, in characters, of a room */
+    unsigned int room_width;
+
+    /** The height, in characters, of a room */
+    unsigned int room_height;
+
+    /** The character to use for walls */
+    char wall_char;
+
+    /** The character to use for the floor */
+    char floor_char;
+} MazeRenderPrintContext;
+
+/**
+ * Prints a single row of rooms.
+ *
+ * This function is a MazeRowCallback, so it can be passed directly to a
+ * streaming generator such as maze_stream_eller. The output of all rows is
+ * identical to that of maze_render_print.
+ *
+ * @param context
+ *     A MazeRenderPrintContext*.
+ * @param y
+ *     The index of the row. This is not used.
+ * @param walls
+ *     The wall bit masks of the rooms in the row.
+ * @param width
+ *     The number of rooms in the row.
+ * @return non-zero if the row was printed, and 0 if writing failed
+ */
+int
+maze_render_print_row(void *context, uint64_t y, const unsigned char *walls,
+    unsigned int width);
+
+/**
+ * The context of maze_render_pbm_row.
+ */
+typedef struct {
+    /** The stream to which to write the image */
+    FILE *stream;
+
+    /** The width, in pixels, of a room */
+    unsigned int room_width;
+
+    /** The height, in pixels, of a room */
+    unsigned int room_height;
+
+    /** The number of rows of rooms in the maze; this is required for the image
+        header */
+    uint64_t height;
+} MazeRenderPbmContext;
+
+/**
+ * Writes a single row of rooms as part of a binary PBM image.
+ *
+ * This function is a MazeRowCallback, so it can be passed directly to a
+ * streaming generator such as maze_stream_eller. The image header is written
+ * together with the first row. Walls are black and the floor is white, and the
+ * layout of a room is the same as for maze_render_print.
+ *
+ * @param context
+ *     A MazeRenderPbmContext*.
+ * @param y
+ *     The index of the row.
+ * @param walls
+ *     The wall bit masks of the rooms in the row.
+ * @param width
+ *     The number of rooms in the row.
+ * @return non-zero if the row was written, and 0 if writing failed
+ */
+int
+maze_render_pbm_row(void *context, uint64_t y, const unsigned char *walls,
+    unsigned int width);
+
 /**
  * Flags for maze_render_gl.
  */
@@ -79,4 +198,24 @@ int
 maze_render_gl(Maze *maze, double wall_width, double slope_width,
     double floor_thickness, int cx, int cy, unsigned int d, int flags);
 
+/**
+ * Renders a part of a world to the current frame buffer.
+ *
+ * The room at (x, y) is placed at (x, -y, 0), so the world extends along the
+ * positive x-axis and the negative y-axis. Chunks are generated as required.
+ *
+ * @param world
+ *     The world to render.
+ * @param wall_width, slope_width, floor_thickness, cx, cy, d, flags
+ *     The same as for maze_render_gl. Since the world has no edge, no floor
+ *     edges are rendered. The rendered rooms and the rooms around them must
+ *     lie within the range of int.
+ * @return 0 if a parameter is incorrect or memory could not be allocated, and
+ *     non-zero otherwise
+ * @see maze_render_gl
+ */
+int
+maze_world_render_gl(MazeWorld *world, double wall_width, double slope_width,
+    double floor_thickness, int cx, int cy, unsigned int d, int flags);
+
 #endif
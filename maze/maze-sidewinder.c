@@ -0,0 +1,104 @@
+#include <stdlib.h>
+
+#include "maze.h"
+
+/**
+ * Initialises a rectangular area of the maze with the Sidewinder algorithm.
+ *
+ * Every row is split into runs of rooms joined horizontally, where one random
+ * bit per room decides whether the run continues to the right. Every run then
+ * opens a door up from one of its rooms. The top row is a single run without a
+ * door up.
+ *
+ * @see MazeGeneratorType.initialize_region
+ */
+static int
+initialize_region(Maze *maze, MazeRandom *random,
+    int x, int y, unsigned int width, unsigned int height,
+    MazeInitializeCallback callback, void *context)
+{
+    unsigned char *walls, *above, *swap;
+    uint64_t *bits;
+    unsigned int words, rx, ry, i, start;
+
+    if (width == 0 || height == 0 || !maze_contains(maze, x, y)
+            || !maze_contains(maze, x + width - 1, y + height - 1)) {
+        return 1;
+    }
+
+    /* The buffers have room for a sentinel after the last room; a row is
+       only merged once the doors down from it are known */
+    words = (width + 63) / 64;
+    walls = malloc(width + 1);
+    above = malloc(width + 1);
+    bits = malloc(sizeof(uint64_t) * words);
+    if (!walls || !above || !bits) {
+        free(walls);
+        free(above);
+        free(bits);
+        return 0;
+    }
+
+    for (ry = 0; ry < height; ry++) {
+        /* The top row has no rooms above, so it is joined completely */
+        for (i = 0; i < words; i++) {
+            bits[i] = ry > 0 ? maze_random_next(random) : ~(uint64_t)0;
+        }
+
+        /* Decide which rooms continue their run to the right */
+        for (rx = 0; rx <= width; rx++) {
+            walls[rx] = 0;
+        }
+        for (rx = 0; rx < width; rx++) {
+            unsigned int bit = (bits[rx / 64] >> (rx % 64)) & 1;
+            unsigned int right = bit & (rx + 1 < width);
+
+            walls[rx] |= right * MAZE_WALL_RIGHT;
+            walls[rx + 1] |= right * MAZE_WALL_LEFT;
+        }
+
+        /* Close every run by opening a door up from a random room in it */
+        if (ry > 0) {
+            for (start = 0, rx = 0; rx < width; rx++) {
+                if (!(walls[rx] & MAZE_WALL_RIGHT)) {
+                    unsigned int door = start
+                        + maze_random_range(random, rx - start + 1);
+
+                    walls[door] |= MAZE_WALL_UP;
+                    above[door] |= MAZE_WALL_DOWN;
+                    start = rx + 1;
+                }
+            }
+            maze_row_merge(maze, x, y + ry - 1, width, above);
+        }
+
+        swap = above;
+        above = walls;
+        walls = swap;
+    }
+    maze_row_merge(maze, x, y + height - 1, width, above);
+
+    free(walls);
+    free(above);
+    free(bits);
+
+    if (callback) {
+        for (ry = 0; ry < height; ry++) {
+            for (rx = 0; rx < width; rx++) {
+                maze_data_set(maze, x + rx, y + ry,
+                    callback(context, maze, x + rx, y + ry, NULL));
+            }
+        }
+    }
+
+    return 1;
+}
+
+const MazeGeneratorType MAZE_GENERATOR_SIDEWINDER = {
+    MAZE_GENERATOR_ID_SIDEWINDER,
+    "sidewinder",
+    initialize_region,
+    NULL,
+    NULL,
+    NULL
+};
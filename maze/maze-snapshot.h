@@ -0,0 +1,138 @@
+#ifndef MAZE_SNAPSHOT_H
+#define MAZE_SNAPSHOT_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "maze.h"
+
+/**
+ * An immutable copy of the walls of a maze at one point in time.
+ *
+ * The walls array is divided into pages of MAZE_SNAPSHOT_PAGE_SIZE bytes.
+ * Once a snapshot has been taken, maze_door_open and maze_row_merge mark the
+ * pages they modify, and the next snapshot only copies those pages; all other
+ * pages are shared with the previous snapshot. Many versions of a maze that
+ * is changed a little at a time therefore cost little more than one copy.
+ *
+ * Room data is not part of a snapshot.
+ */
+typedef struct MazeSnapshot MazeSnapshot;
+
+/**
+ * A function called for every room that differs between two snapshots.
+ *
+ * @param context
+ *     The user context.
+ * @param x, y
+ *     The coordinates of the room.
+ * @param before, after
+ *     The walls of the room in the first and second snapshot.
+ */
+typedef void (*MazeSnapshotDiffCallback)(void *context, int x, int y,
+    unsigned char before, unsigned char after);
+
+/**
+ * Takes a snapshot of a maze.
+ *
+ * The first snapshot of a maze copies all of it and starts tracking
+ * modifications; later snapshots only copy the pages modified since the
+ * previous one.
+ *
+ * @param maze
+ *     The maze.
+ * @return a new snapshot, or NULL if memory could not be allocated
+ */
+MazeSnapshot*
+maze_snapshot_create(Maze *maze);
+
+/**
+ * Releases a snapshot.
+ *
+ * Pages still shared with other snapshots are kept.
+ *
+ * @param snapshot
+ *     The snapshot to release. This may be NULL.
+ */
+void
+maze_snapshot_free(MazeSnapshot *snapshot);
+
+/**
+ * Retrieves the wall value of a room in a snapshot.
+ *
+ * @param snapshot
+ *     The snapshot.
+ * @param x, y
+ *     The coordinates of the room. The edge rooms are included.
+ * @return the value of the room, or MAZE_WALL_ANY if it lies outside of the
+ *     maze and its edge rooms
+ */
+unsigned char
+maze_snapshot_room_get(MazeSnapshot *snapshot, int x, int y);
+
+/**
+ * Restores the walls of a maze to a snapshot.
+ *
+ * Only pages that differ between the maze and the snapshot are copied. The
+ * snapshot becomes the last snapshot of the maze.
+ *
+ * @param snapshot
+ *     The snapshot.
+ * @param maze
+ *     The maze. It must have the dimensions and layout of the snapshot, and
+ *     must not be a mapped maze.
+ * @return non-zero if the maze was restored, or 0 if its dimensions or layout
+ *     differ, or memory for tracking modifications could not be allocated
+ */
+int
+maze_snapshot_restore(MazeSnapshot *snapshot, Maze *maze);
+
+/**
+ * Lists the rooms that differ between two snapshots.
+ *
+ * Only pages not shared between the snapshots are compared, so comparing two
+ * versions of a maze takes time proportional to the number of pages changed
+ * between them, plus one pointer comparison per page.
+ *
+ * @param a, b
+ *     The snapshots to compare. These must have the same dimensions and
+ *     layout.
+ * @param callback
+ *     The function called for every differing room, in the order of the walls
+ *     array. This may be NULL.
+ * @param context
+ *     The user context passed to the callback function.
+ * @return the number of differing rooms, not counting edge rooms
+ */
+size_t
+maze_snapshot_diff(MazeSnapshot *a, MazeSnapshot *b,
+    MazeSnapshotDiffCallback callback, void *context);
+
+/**
+ * Stops tracking modifications of a maze and releases its last snapshot.
+ *
+ * Snapshots held elsewhere remain valid. This is called by maze_free.
+ *
+ * @param maze
+ *     The maze.
+ */
+void
+maze_snapshot_stop(Maze *maze);
+
+/**
+ * Calculates the number of words in the bit mask of modified pages of a maze.
+ *
+ * @param maze
+ *     The maze.
+ * @return the number of words of Maze.dirty
+ */
+static inline size_t
+maze_snapshot_dirty_words(Maze *maze)
+{
+    size_t pages = (maze->walls_size + MAZE_SNAPSHOT_PAGE_SIZE - 1)
+        / MAZE_SNAPSHOT_PAGE_SIZE;
+
+    return (pages + 63) / 64;
+}
+
+#endif
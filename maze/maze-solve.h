@@ -0,0 +1,88 @@
+#ifndef MAZE_SOLVE_H
+#define MAZE_SOLVE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "maze.h"
+
+/**
+ * The memory used by maze_solve.
+ *
+ * A workspace holds a visited bit per room, a 2 bit direction per room
+ * leading back towards the start, a ring buffer queue and the steps of the
+ * last path found. It grows to fit the largest maze and path it has been used
+ * for, so once it has reached that size, solving does not allocate memory.
+ *
+ * A workspace must not be used by several threads at the same time; give
+ * every thread its own.
+ */
+typedef struct MazeSolveWorkspace MazeSolveWorkspace;
+
+/**
+ * A path through a maze.
+ */
+typedef struct {
+    /** The number of steps */
+    size_t length;
+
+    /** The direction of every step, as one of the MAZE_WALL_* values. This
+        points into the workspace, and is valid until it is used again */
+    const unsigned char *steps;
+} MazePath;
+
+/**
+ * Creates an empty workspace.
+ *
+ * @return a new workspace, or NULL if memory could not be allocated
+ */
+MazeSolveWorkspace*
+maze_solve_workspace_create(void);
+
+/**
+ * Frees all resources allocated by a workspace.
+ *
+ * @param workspace
+ *     The workspace to release.
+ */
+void
+maze_solve_workspace_free(MazeSolveWorkspace *workspace);
+
+/**
+ * Grows a workspace to fit a maze, so that solving it does not allocate
+ * memory except for unusually long paths.
+ *
+ * @param workspace
+ *     The workspace.
+ * @param maze
+ *     The maze.
+ * @return non-zero unless memory could not be allocated
+ */
+int
+maze_solve_workspace_reserve(MazeSolveWorkspace *workspace, Maze *maze);
+
+/**
+ * Finds a shortest path between two rooms.
+ *
+ * The rooms and the path may include the edge rooms, so the doors leading out
+ * of the maze act as entrances connected around the outside of the maze.
+ *
+ * @param maze
+ *     The maze.
+ * @param sx, sy
+ *     The coordinates of the first room.
+ * @param tx, ty
+ *     The coordinates of the last room.
+ * @param workspace
+ *     The workspace to use.
+ * @param path
+ *     Receives the path. This may be NULL if only the existence of a path is
+ *     of interest.
+ * @return non-zero if a path was found, or 0 if the rooms are not connected,
+ *     lie outside of maze_edge_contains, or memory could not be allocated
+ */
+int
+maze_solve(Maze *maze, int sx, int sy, int tx, int ty,
+    MazeSolveWorkspace *workspace, MazePath *path);
+
+#endif
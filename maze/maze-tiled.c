@@ -0,0 +1,216 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "maze.h"
+
+/**
+ * The default width and height of a tile.
+ */
+#define DEFAULT_TILE_SIZE 256
+
+/**
+ * The state shared between all worker threads.
+ */
+typedef struct {
+    /** The maze being initialised */
+    Maze *maze;
+
+    /** The algorithm used to initialise every tile */
+    const MazeGeneratorType *type;
+
+    /** The width and height of a tile */
+    unsigned int tile_size;
+
+    /** The number of tiles in the horizontal direction */
+    unsigned int tiles_x;
+
+    /** The total number of tiles */
+    size_t tile_count;
+
+    /** The random number generator of every tile */
+    MazeRandom *randoms;
+
+    /** The index of the next tile to initialise */
+    size_t next;
+
+    /** Set if a tile could not be initialised; this is written by several
+        workers, so it is set atomically */
+    int failed;
+
+    /** The callback function and its context */
+    MazeInitializeCallback callback;
+    void *context;
+} Work;
+
+/**
+ * Returns the current time.
+ *
+ * @return a monotonic time in seconds
+ */
+static double
+now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+/**
+ * Initialises tiles until there are no more tiles left.
+ *
+ * @param data
+ *     The Work shared between all threads.
+ * @return NULL
+ */
+static void*
+worker(void *data)
+{
+    Work *work = data;
+    size_t index;
+
+    while ((index = __sync_fetch_and_add(&work->next, 1)) < work->tile_count) {
+        unsigned int x = (index % work->tiles_x) * work->tile_size;
+        unsigned int y = (index / work->tiles_x) * work->tile_size;
+        unsigned int width = work->maze->width - x;
+        unsigned int height = work->maze->height - y;
+
+        if (!work->type->initialize_region(work->maze,
+                &work->randoms[index], x, y,
+                width < work->tile_size ? width : work->tile_size,
+                height < work->tile_size ? height : work->tile_size,
+                work->callback, work->context)) {
+            __sync_lock_test_and_set(&work->failed, 1);
+        }
+    }
+
+    return NULL;
+}
+
+int
+maze_initialize_tiled(Maze *maze, const MazeGeneratorType *type,
+    MazeRandom *random, unsigned int tile_size, unsigned int threads,
+    MazeInitializeCallback callback, void *context,
+    MazeTiledTimings *timings)
+{
+    Work work;
+    MazeRandom stream;
+    Maze *tiles;
+    pthread_t *handles;
+    unsigned int started, tx, ty;
+    size_t i;
+    double start, split_end, generate_end;
+
+    if (maze->width == 0 || maze->height == 0) {
+        return 1;
+    }
+
+    if (tile_size == 0) {
+        tile_size = DEFAULT_TILE_SIZE;
+    }
+    if (threads == 0) {
+        long processors = sysconf(_SC_NPROCESSORS_ONLN);
+
+        threads = processors > 0 ? (unsigned int)processors : 1;
+    }
+
+    work.maze = maze;
+    work.type = type ? type : &MAZE_GENERATOR_RANDOMIZED_PRIM;
+    work.tile_size = tile_size;
+    work.tiles_x = maze->width / tile_size + (maze->width % tile_size != 0);
+    work.tile_count = (size_t)work.tiles_x
+        * (maze->height / tile_size + (maze->height % tile_size != 0));
+    work.next = 0;
+    work.failed = 0;
+    work.callback = callback;
+    work.context = context;
+    work.randoms = malloc(sizeof(MazeRandom) * work.tile_count);
+    tiles = maze_create(work.tiles_x, work.tile_count / work.tiles_x);
+    handles = malloc(sizeof(pthread_t) * threads);
+    /* The workers must not race to allocate the data array */
+    if (!work.randoms || !tiles || !handles
+            || (callback && !maze_data_allocate(maze))) {
+        free(work.randoms);
+        maze_free(tiles);
+        free(handles);
+        return 0;
+    }
+
+    /* Give every tile its own stream, and move random past all of them */
+    start = now();
+    stream = *random;
+    for (i = 0; i < work.tile_count; i++) {
+        maze_random_jump(&stream);
+        work.randoms[i] = stream;
+    }
+    maze_random_long_jump(random);
+    split_end = now();
+
+    /* The calling thread is a worker as well; if a thread cannot be started,
+       the remaining threads will simply pick up its share */
+    for (started = 0; started < threads - 1; started++) {
+        if (pthread_create(&handles[started], NULL, worker, &work) != 0) {
+            break;
+        }
+    }
+    worker(&work);
+    for (i = 0; i < started; i++) {
+        pthread_join(handles[i], NULL);
+    }
+    generate_end = now();
+
+    /* A tile without doors cannot be joined into a perfect maze */
+    if (work.failed) {
+        free(work.randoms);
+        maze_free(tiles);
+        free(handles);
+        return 0;
+    }
+
+    /* Join the tiles along a spanning tree; every open door between two
+       tiles becomes a door at a random position of their common edge */
+    if (!maze_initialize_randomized_prim_region(tiles, random, 0, 0,
+            tiles->width, tiles->height, NULL, NULL)) {
+        free(work.randoms);
+        maze_free(tiles);
+        free(handles);
+        return 0;
+    }
+    for (ty = 0; ty < tiles->height; ty++) {
+        for (tx = 0; tx < tiles->width; tx++) {
+            unsigned char walls = maze_room_get(tiles, tx, ty);
+            unsigned int x = tx * tile_size;
+            unsigned int y = ty * tile_size;
+            unsigned int width = maze->width - x < tile_size
+                ? maze->width - x
+                : tile_size;
+            unsigned int height = maze->height - y < tile_size
+                ? maze->height - y
+                : tile_size;
+
+            if (walls & MAZE_WALL_RIGHT) {
+                maze_door_open(maze, x + width - 1,
+                    y + maze_random_range(random, height), MAZE_WALL_RIGHT);
+            }
+            if (walls & MAZE_WALL_DOWN) {
+                maze_door_open(maze, x + maze_random_range(random, width),
+                    y + height - 1, MAZE_WALL_DOWN);
+            }
+        }
+    }
+
+    if (timings) {
+        timings->split = split_end - start;
+        timings->generate = generate_end - split_end;
+        timings->join = now() - generate_end;
+    }
+
+    free(work.randoms);
+    maze_free(tiles);
+    free(handles);
+
+    return 1;
+}
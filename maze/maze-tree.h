@@ -0,0 +1,74 @@
+#ifndef MAZE_TREE_H
+#define MAZE_TREE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "maze.h"
+
+/**
+ * An index answering distance queries in a perfect maze.
+ *
+ * In a perfect maze the rooms and doors form a spanning tree, so the path
+ * between two rooms always passes through their lowest common ancestor. The
+ * index roots the tree in the top left room and stores an Euler tour of it
+ * with the depth of every room; the lowest common ancestor is the shallowest
+ * room of the tour between the first visits of the two rooms, which is found
+ * in constant time with a sparse table over blocks of the tour and a bit mask
+ * per position within a block.
+ *
+ * The index is a copy; it is not updated when the maze changes. Doors leading
+ * out of the maze are ignored.
+ */
+typedef struct MazeTreeIndex MazeTreeIndex;
+
+/**
+ * Builds the index of a perfect maze.
+ *
+ * @param maze
+ *     The maze. It must have at most 2^31 rooms.
+ * @return a new index, or NULL if the maze is not a perfect maze, is too
+ *     large, or memory could not be allocated
+ */
+MazeTreeIndex*
+maze_tree_index_create(Maze *maze);
+
+/**
+ * Frees all resources allocated by an index.
+ *
+ * @param index
+ *     The index to release.
+ */
+void
+maze_tree_index_free(MazeTreeIndex *index);
+
+/**
+ * Calculates the length of the path between two rooms.
+ *
+ * @param index
+ *     The index of the maze.
+ * @param ax, ay
+ *     The coordinates of the first room. These must be within the maze.
+ * @param bx, by
+ *     The coordinates of the second room. These must be within the maze.
+ * @return the number of steps between the rooms
+ */
+size_t
+maze_distance(MazeTreeIndex *index, int ax, int ay, int bx, int by);
+
+/**
+ * Finds the first step of the path between two rooms.
+ *
+ * @param index
+ *     The index of the maze.
+ * @param ax, ay
+ *     The coordinates of the first room. These must be within the maze.
+ * @param bx, by
+ *     The coordinates of the second room. These must be within the maze.
+ * @return the wall of the first room to pass through, as one of the
+ *     MAZE_WALL_* values, or 0 if the rooms are the same
+ */
+unsigned char
+maze_path_next_step(MazeTreeIndex *index, int ax, int ay, int bx, int by);
+
+#endif
@@ -0,0 +1,308 @@
+#include <limits.h>
+#include <stdlib.h>
+
+#include "maze.h"
+
+/**
+ * The flag set in the scratch byte of a room that is part of the maze.
+ */
+#define IN_TREE 0x80
+
+/**
+ * The mask of the direction index stored in the scratch byte of a room that is
+ * part of the current walk.
+ */
+#define DIRECTION 0x03
+
+/**
+ * The walls in the order of their direction indices.
+ */
+static const unsigned char WALLS[] = {
+    MAZE_WALL_LEFT, MAZE_WALL_UP, MAZE_WALL_RIGHT, MAZE_WALL_DOWN};
+
+/**
+ * The horizontal and vertical movement for every direction index.
+ */
+static const int DX[] = {-1, 0, 1, 0};
+static const int DY[] = {0, -1, 0, 1};
+
+/**
+ * The state of a random walk over an area.
+ */
+typedef struct {
+    /** The random number generator */
+    MazeRandom *random;
+
+    /** Random bits not yet used */
+    uint64_t bits;
+
+    /** The number of bits left in bits */
+    unsigned int count;
+
+    /** The dimensions of the area */
+    int width, height;
+} Walk;
+
+/**
+ * Picks a random direction that leads to a room within the area.
+ *
+ * Every valid direction is equally likely.
+ *
+ * @param walk
+ *     The walk.
+ * @param x, y
+ *     The current room, relative to the area.
+ * @return the direction index
+ */
+static inline unsigned int
+walk_direction(Walk *walk, int x, int y)
+{
+    for (;;) {
+        unsigned int direction;
+        int nx, ny;
+
+        if (walk->count == 0) {
+            walk->bits = maze_random_next(walk->random);
+            walk->count = 32;
+        }
+        direction = walk->bits & 3;
+        walk->bits >>= 2;
+        walk->count--;
+
+        nx = x + DX[direction];
+        ny = y + DY[direction];
+        if (nx >= 0 && nx < walk->width && ny >= 0 && ny < walk->height) {
+            return direction;
+        }
+    }
+}
+
+/**
+ * The phases of a loop-erased random walk.
+ */
+enum {
+    /** Looking for a room that is not yet in the maze */
+    PHASE_SCAN,
+
+    /** Walking randomly until a room in the maze is reached */
+    PHASE_WALK,
+
+    /** Adding the loop-erased walk to the maze */
+    PHASE_ADD
+};
+
+/**
+ * The state of an initialisation.
+ */
+typedef struct {
+    /** The maze being initialised */
+    Maze *maze;
+
+    /** The area being initialised */
+    int x, y;
+
+    /** The callback function and its context */
+    MazeInitializeCallback callback;
+    void *context;
+
+    /** The random walk */
+    Walk walk;
+
+    /** One byte per room in the area; IN_TREE is set for rooms in the maze,
+        and the other rooms store the last direction taken by the walk */
+    unsigned char *scratch;
+
+    /** The number of rooms not yet in the maze */
+    size_t remaining;
+
+    /** The index of the next room to consider as the start of a walk */
+    size_t index;
+
+    /** The current phase */
+    int phase;
+
+    /** The start of the current walk, relative to the area */
+    int sx, sy;
+
+    /** The current room of the walk, relative to the area */
+    int cx, cy;
+} Wilson;
+
+/**
+ * Adds a room to the maze and calls the callback for it.
+ *
+ * @param wilson
+ *     The state.
+ * @param rx, ry
+ *     The room, relative to the area.
+ */
+static inline void
+room_add(Wilson *wilson, int rx, int ry)
+{
+    wilson->scratch[(size_t)ry * wilson->walk.width + rx] = IN_TREE;
+
+    if (wilson->callback) {
+        int x = wilson->x + rx, y = wilson->y + ry;
+
+        maze_data_set(wilson->maze, x, y,
+            wilson->callback(wilson->context, wilson->maze, x, y, NULL));
+    }
+}
+
+/**
+ * Starts initialising a rectangular area of the maze.
+ *
+ * @see MazeGeneratorType.begin
+ */
+static void*
+begin(Maze *maze, MazeRandom *random,
+    int x, int y, unsigned int width, unsigned int height,
+    MazeInitializeCallback callback, void *context)
+{
+    Wilson *wilson;
+
+    wilson = malloc(sizeof(Wilson));
+    if (!wilson) {
+        return NULL;
+    }
+    wilson->scratch = calloc((size_t)width * height, 1);
+    if (!wilson->scratch) {
+        free(wilson);
+        return NULL;
+    }
+
+    wilson->maze = maze;
+    wilson->x = x;
+    wilson->y = y;
+    wilson->callback = callback;
+    wilson->context = context;
+    wilson->walk.random = random;
+    wilson->walk.bits = 0;
+    wilson->walk.count = 0;
+    wilson->walk.width = width;
+    wilson->walk.height = height;
+    wilson->remaining = (size_t)width * height - 1;
+    wilson->index = 0;
+    wilson->phase = PHASE_SCAN;
+    wilson->sx = wilson->cx = 0;
+    wilson->sy = wilson->cy = 0;
+
+    /* Start with a single random room */
+    room_add(wilson, maze_random_range(random, width),
+        maze_random_range(random, height));
+
+    return wilson;
+}
+
+/**
+ * Adds rooms with loop-erased random walks.
+ *
+ * The last direction taken from a room is stored in its scratch byte, which
+ * erases any loop when the walk returns to the room. Every step of a walk
+ * counts towards max_rooms.
+ *
+ * @see MazeGeneratorType.step
+ */
+static int
+step(void *state, unsigned int max_rooms, size_t *rooms)
+{
+    Wilson *w = state;
+    int width = w->walk.width;
+    unsigned int steps, direction;
+
+    for (steps = 0; steps < max_rooms && w->remaining > 0; steps++) {
+        unsigned char *current = &w->scratch[(size_t)w->cy * width + w->cx];
+
+        switch (w->phase) {
+        case PHASE_SCAN:
+            while (w->scratch[w->index] & IN_TREE) {
+                w->index++;
+            }
+            w->sx = w->cx = w->index % width;
+            w->sy = w->cy = w->index / width;
+            w->phase = PHASE_WALK;
+            break;
+
+        case PHASE_WALK:
+            if (*current & IN_TREE) {
+                w->cx = w->sx;
+                w->cy = w->sy;
+                w->phase = PHASE_ADD;
+                break;
+            }
+            direction = walk_direction(&w->walk, w->cx, w->cy);
+            *current = direction;
+            w->cx += DX[direction];
+            w->cy += DY[direction];
+            break;
+
+        case PHASE_ADD:
+            if (*current & IN_TREE) {
+                w->phase = PHASE_SCAN;
+                break;
+            }
+            direction = *current & DIRECTION;
+            maze_door_open(w->maze, w->x + w->cx, w->y + w->cy,
+                WALLS[direction]);
+            room_add(w, w->cx, w->cy);
+            w->remaining--;
+            (*rooms)++;
+            w->cx += DX[direction];
+            w->cy += DY[direction];
+            break;
+        }
+    }
+
+    return w->remaining > 0;
+}
+
+/**
+ * Releases the state.
+ *
+ * @see MazeGeneratorType.end
+ */
+static void
+end(void *state)
+{
+    Wilson *wilson = state;
+
+    free(wilson->scratch);
+    free(wilson);
+}
+
+/**
+ * Initialises a rectangular area of the maze with Wilson's algorithm.
+ *
+ * @see MazeGeneratorType.initialize_region
+ */
+static int
+initialize_region(Maze *maze, MazeRandom *random,
+    int x, int y, unsigned int width, unsigned int height,
+    MazeInitializeCallback callback, void *context)
+{
+    void *state;
+    size_t rooms = 0;
+
+    if (width == 0 || height == 0 || !maze_contains(maze, x, y)
+            || !maze_contains(maze, x + width - 1, y + height - 1)) {
+        return 1;
+    }
+
+    state = begin(maze, random, x, y, width, height, callback, context);
+    if (!state) {
+        return 0;
+    }
+    while (step(state, UINT_MAX, &rooms));
+    end(state);
+
+    return 1;
+}
+
+const MazeGeneratorType MAZE_GENERATOR_WILSON = {
+    MAZE_GENERATOR_ID_WILSON,
+    "wilson",
+    initialize_region,
+    begin,
+    step,
+    end
+};
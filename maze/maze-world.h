@@ -0,0 +1,86 @@
+#ifndef MAZE_WORLD_H
+#define MAZE_WORLD_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "maze.h"
+
+/**
+ * An unbounded maze that is generated in chunks on demand.
+ *
+ * The world is divided into square chunks. Every chunk is a perfect maze
+ * generated from the seed of the world and the coordinates of the chunk when
+ * it is first accessed, and neighbouring chunks are joined by a single door at
+ * a position derived from the seed, so the result does not depend on the order
+ * in which chunks are accessed. Chunks that have not been accessed recently
+ * are released when the memory limit is reached, and are generated again if
+ * accessed later.
+ */
+typedef struct MazeWorld MazeWorld;
+
+/**
+ * Creates a new world.
+ *
+ * @param type
+ *     The algorithm used to generate chunks.
+ * @param seed
+ *     The seed of the world.
+ * @param chunk_size
+ *     The width and height of a chunk. This must not be 0.
+ * @param max_bytes
+ *     The maximum number of bytes to use for chunks. At least one chunk is
+ *     always kept.
+ * @return a new world, or NULL if memory could not be allocated
+ */
+MazeWorld*
+maze_world_create(const MazeGeneratorType *type, uint64_t seed,
+    unsigned int chunk_size, size_t max_bytes);
+
+/**
+ * Frees all resources allocated by a world.
+ *
+ * @param world
+ *     The world to release.
+ */
+void
+maze_world_free(MazeWorld *world);
+
+/**
+ * Retrieves the wall value of a room in a world.
+ *
+ * The chunk containing the room is generated if it is not in memory.
+ *
+ * @param world
+ *     The world.
+ * @param x, y
+ *     The coordinates of the room. Any coordinates are valid.
+ * @return the value of the room, or MAZE_WALL_ANY if the chunk could not be
+ *     allocated or generated
+ */
+unsigned char
+maze_world_room_get(MazeWorld *world, int x, int y);
+
+/**
+ * Copies a rectangular part of a world into a maze.
+ *
+ * The maze is owned by the world and is valid until the next call to this
+ * function or until the world is freed. Its room at (0, 0) corresponds to the
+ * room at (x, y) in the world; coordinates beyond the limits of int wrap
+ * around. Doors leading out of the window are open in the rooms along its
+ * edge, and the edge rooms surrounding the maze are filled in with
+ * maze_edge_update, so that maze_room_get reads the matching doors from them.
+ *
+ * @param world
+ *     The world.
+ * @param x, y
+ *     The coordinates of the top left room to copy.
+ * @param width, height
+ *     The dimensions of the window.
+ * @return the window, or NULL if memory could not be allocated
+ */
+Maze*
+maze_world_window(MazeWorld *world, int x, int y, unsigned int width,
+    unsigned int height);
+
+#endif
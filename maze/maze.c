@@ -1,17 +1,207 @@
+#include <limits.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 
 #include "maze.h"
+#include "maze-snapshot.h"
+
+/**
+ * The size of a huge page. Smaller walls arrays are never mapped separately.
+ */
+#define HUGE_PAGE_SIZE ((size_t)2 << 20)
+
+/**
+ * Allocates memory with malloc.
+ *
+ * @see MazeAllocator.alloc
+ */
+static void*
+default_alloc(void *context, size_t size)
+{
+    return malloc(size);
+}
+
+/**
+ * Releases memory with free.
+ *
+ * @see MazeAllocator.free
+ */
+static void
+default_free(void *context, void *memory, size_t size)
+{
+    free(memory);
+}
+
+const MazeAllocator MAZE_ALLOCATOR_MALLOC = {
+    default_alloc,
+    default_free,
+    NULL
+};
+
+/**
+ * Marks the page containing a room as modified since the last snapshot.
+ *
+ * @param maze
+ *     The maze.
+ * @param index
+ *     The index of the room in the walls array.
+ */
+static inline void
+dirty_mark(Maze *maze, size_t index)
+{
+    if (maze->dirty) {
+        size_t page = index / MAZE_SNAPSHOT_PAGE_SIZE;
+        uint64_t bit = (uint64_t)1 << (page % 64);
+
+        /* One word covers the pages of several tiles, which
+           maze_initialize_tiled modifies from different threads; the bit is
+           usually set already, so only write it when it is not */
+        if (!(__atomic_load_n(&maze->dirty[page / 64], __ATOMIC_RELAXED)
+                & bit)) {
+            __atomic_fetch_or(&maze->dirty[page / 64], bit, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/**
+ * Multiplies two sizes.
+ *
+ * @param a, b
+ *     The sizes to multiply.
+ * @param result
+ *     The product. This is only set if it does not overflow.
+ * @return non-zero if the product does not overflow
+ */
+static int
+size_multiply(size_t a, size_t b, size_t *result)
+{
+    if (b != 0 && a > SIZE_MAX / b) {
+        return 0;
+    }
+    *result = a * b;
+
+    return 1;
+}
+
+/**
+ * Maps zeroed memory that should be backed by huge pages.
+ *
+ * @param size
+ *     The size of the mapping. This should be a multiple of HUGE_PAGE_SIZE.
+ * @return the mapping, or NULL if it could not be created
+ */
+static void*
+huge_map(size_t size)
+{
+    void *result = mmap(NULL, size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (result == MAP_FAILED) {
+        return NULL;
+    }
+
+#ifdef MADV_HUGEPAGE
+    /* This is only a hint; the mapping works without huge pages as well */
+    madvise(result, size, MADV_HUGEPAGE);
+#endif
+
+    return result;
+}
+
+int
+maze_walls_size(unsigned int width, unsigned int height, MazeLayout layout,
+    size_t *size)
+{
+    /* Coordinates must fit in an int */
+    if (width > INT_MAX || height > INT_MAX) {
+        return 0;
+    }
+
+    /* The edge rooms make the walls array two rooms larger in both
+       directions */
+    if (layout == MAZE_LAYOUT_TILES) {
+        return size_multiply(((size_t)width + 9) >> 3,
+                ((size_t)height + 9) >> 3, size)
+            && size_multiply(*size, 64, size);
+    }
+    else {
+        return size_multiply((size_t)width + 2, (size_t)height + 2, size);
+    }
+}
 
 Maze*
 maze_create(unsigned int width, unsigned int height)
 {
-    Maze *result = malloc(sizeof(Maze) + sizeof(Room) * width * height);
+    return maze_create_ex(width, height, NULL);
+}
+
+Maze*
+maze_create_layout(unsigned int width, unsigned int height,
+    MazeLayout layout)
+{
+    MazeCreateOptions options = {layout, NULL, 0};
+
+    return maze_create_ex(width, height, &options);
+}
+
+Maze*
+maze_create_ex(unsigned int width, unsigned int height,
+    const MazeCreateOptions *options)
+{
+    static const MazeCreateOptions defaults = {MAZE_LAYOUT_ROWS, NULL, 0};
+    const MazeAllocator *allocator;
+    size_t size;
+    void *mapping = NULL;
+    size_t mapping_size = 0;
+    Maze *result;
+
+    if (!options) {
+        options = &defaults;
+    }
+    allocator = options->allocator
+        ? options->allocator
+        : &MAZE_ALLOCATOR_MALLOC;
+
+    if (!maze_walls_size(width, height, options->layout, &size)
+            || size > SIZE_MAX - sizeof(Maze) - HUGE_PAGE_SIZE) {
+        return NULL;
+    }
+
+    if (options->flags & MAZE_CREATE_HUGE_PAGES && size >= HUGE_PAGE_SIZE) {
+        mapping_size = (size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+        mapping = huge_map(mapping_size);
+    }
+
+    result = allocator->alloc(allocator->context,
+        sizeof(Maze) + (mapping ? 0 : size));
+    if (!result) {
+        if (mapping) {
+            munmap(mapping, mapping_size);
+        }
+        return NULL;
+    }
 
     result->width = width;
     result->height = height;
-    result->data = (Room*)(result + 1);
-    memset(result->data, 0, sizeof(Room) * width * height);
+    result->layout = options->layout;
+    result->data = NULL;
+    result->allocator = *allocator;
+    result->walls_size = size;
+    result->mapping = mapping;
+    result->mapping_size = mapping ? mapping_size : 0;
+    result->dirty = NULL;
+    result->snapshot = NULL;
+    if (mapping) {
+        /* Anonymous mappings are already zeroed */
+        result->walls = mapping;
+    }
+    else {
+        result->walls = (unsigned char*)(result + 1);
+        memset(result->walls, 0, size);
+    }
+    maze_edge_update(result);
 
     return result;
 }
@@ -19,22 +209,162 @@ maze_create(unsigned int width, unsigned int height)
 void
 maze_free(Maze *maze)
 {
-    free(maze);
+    MazeAllocator allocator;
+
+    if (!maze) {
+        return;
+    }
+
+    maze_snapshot_stop(maze);
+    allocator = maze->allocator;
+    if (maze->data) {
+        allocator.free(allocator.context, maze->data,
+            sizeof(void*) * maze->width * maze->height);
+    }
+    if (maze->mapping) {
+        munmap(maze->mapping, maze->mapping_size);
+    }
+    allocator.free(allocator.context, maze,
+        sizeof(Maze) + (maze->mapping ? 0 : maze->walls_size));
+}
+
+int
+maze_data_allocate(Maze *maze)
+{
+    size_t size;
+
+    if (maze->data) {
+        return 1;
+    }
+
+    /* The number of rooms fits, since the walls array is larger */
+    if (!size_multiply((size_t)maze->width * maze->height, sizeof(void*),
+            &size)) {
+        return 0;
+    }
+    maze->data = maze->allocator.alloc(maze->allocator.context, size);
+    if (maze->data) {
+        memset(maze->data, 0, size);
+    }
+
+    return maze->data != NULL;
+}
+
+/**
+ * Calculates the value of an edge room.
+ *
+ * @param maze
+ *     The maze.
+ * @param x, y
+ *     The coordinates of the room inside the maze next to the edge room.
+ * @param wall
+ *     The wall of the room inside the maze that leads to the edge room.
+ * @return the value of the edge room
+ */
+static unsigned char
+edge_room(Maze *maze, int x, int y, unsigned char wall)
+{
+    if (!maze_contains(maze, x, y)
+            || maze->walls[maze_index(maze, x, y)] & wall) {
+        return MAZE_WALL_ANY;
+    }
+    else {
+        return MAZE_WALL_ANY & ~maze_wall_opposite(wall);
+    }
+}
+
+void
+maze_edge_update(Maze *maze)
+{
+    int width = maze->width, height = maze->height;
+    int x, y;
+
+    if (maze->dirty) {
+        memset(maze->dirty, 0xff, sizeof(uint64_t)
+            * maze_snapshot_dirty_words(maze));
+    }
+
+    /* The corners are not next to any room, so they are always open */
+    for (x = -1; x <= width; x++) {
+        maze->walls[maze_index(maze, x, -1)] =
+            edge_room(maze, x, 0, MAZE_WALL_UP);
+        maze->walls[maze_index(maze, x, height)] =
+            edge_room(maze, x, height - 1, MAZE_WALL_DOWN);
+    }
+    for (y = 0; y < height; y++) {
+        maze->walls[maze_index(maze, -1, y)] =
+            edge_room(maze, 0, y, MAZE_WALL_LEFT);
+        maze->walls[maze_index(maze, width, y)] =
+            edge_room(maze, width - 1, y, MAZE_WALL_RIGHT);
+    }
+}
+
+const unsigned char*
+maze_row_read(Maze *maze, int x, int y, unsigned int width,
+    unsigned char *buffer)
+{
+    unsigned int i;
+
+    if (maze->layout == MAZE_LAYOUT_ROWS) {
+        return maze->walls + maze_index(maze, x, y);
+    }
+
+    for (i = 0; i < width; i++) {
+        buffer[i] = maze->walls[maze_index(maze, x + i, y)];
+    }
+
+    return buffer;
+}
+
+void
+maze_row_merge(Maze *maze, int x, int y, unsigned int width,
+    const unsigned char *walls)
+{
+    unsigned int i;
+
+    if (maze->layout == MAZE_LAYOUT_ROWS) {
+        size_t index = maze_index(maze, x, y);
+        unsigned char *row = maze->walls + index;
+
+        for (i = 0; i < width; i++) {
+            row[i] |= walls[i];
+        }
+        if (maze->dirty && width > 0) {
+            for (i = 0; i < width; i += MAZE_SNAPSHOT_PAGE_SIZE) {
+                dirty_mark(maze, index + i);
+            }
+            dirty_mark(maze, index + width - 1);
+        }
+    }
+    else {
+        for (i = 0; i < width; i++) {
+            size_t index = maze_index(maze, x + i, y);
+
+            maze->walls[index] |= walls[i];
+            dirty_mark(maze, index);
+        }
+    }
 }
 
 int
 maze_door_open(Maze *maze, int x, int y, unsigned char wall)
 {
+    size_t index;
+
     /* The room lies outside of the maze */
     if (!maze_contains(maze, x, y)) {
         return 0;
     }
 
-    maze->data[y * maze->width + x].walls |= wall;
+    index = maze_index(maze, x, y);
+    maze->walls[index] |= wall;
+    dirty_mark(maze, index);
 
-    /* Open the opposite door in the other room if it lies within the maze */
-    if (maze_door_enter(maze, &x, &y, wall, 0) && maze_contains(maze, x, y)) {
-        maze->data[y * maze->width + x].walls |= maze_wall_opposite(wall);
+    /* Open the opposite door in the other room, which may be an edge room */
+    if (maze_door_enter(maze, &x, &y, wall, 0)) {
+        index = maze_index(maze, x, y);
+        maze->walls[index] |= maze_wall_opposite(wall);
+        dirty_mark(maze, index);
     }
 
     return 1;
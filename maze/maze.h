@@ -3,6 +3,8 @@
 
 #include <stdlib.h>
 
+#include "maze-random.h"
+
 /**
  * The bit masks used for the walls.
  */
@@ -48,21 +50,97 @@ enum {
 
 
 /**
- * A room.
- *
- * A maze is a matrix of rooms.
+ * The orders in which the rooms of a maze can be stored.
+ */
+typedef enum {
+    /** The rooms are stored row by row */
+    MAZE_LAYOUT_ROWS,
+
+    /** The rooms are stored in tiles of 8 x 8 rooms, which are stored row by
+        row; a tile fits in a single cache line, so vertical neighbours are
+        usually close */
+    MAZE_LAYOUT_TILES
+} MazeLayout;
+
+/**
+ * A memory allocator used for a maze.
+ */
+typedef struct {
+    /**
+     * Allocates memory.
+     *
+     * @param context
+     *     The context of the allocator.
+     * @param size
+     *     The number of bytes to allocate.
+     * @return the memory, or NULL if it could not be allocated
+     */
+    void* (*alloc)(void *context, size_t size);
+
+    /**
+     * Releases memory allocated by alloc.
+     *
+     * @param context
+     *     The context of the allocator.
+     * @param memory
+     *     The memory to release.
+     * @param size
+     *     The number of bytes passed to alloc.
+     */
+    void (*free)(void *context, void *memory, size_t size);
+
+    /** The context passed to the functions */
+    void *context;
+} MazeAllocator;
+
+/**
+ * The allocator that uses malloc and free, which is used when no allocator is
+ * specified.
+ */
+extern const MazeAllocator MAZE_ALLOCATOR_MALLOC;
+
+/**
+ * The flags for MazeCreateOptions.
+ */
+enum {
+    /** Back the walls of large mazes by a separate memory mapping that uses
+        huge pages, where the system supports them */
+    MAZE_CREATE_HUGE_PAGES = 1 << 0
+};
+
+/**
+ * The options for maze_create_ex.
  */
 typedef struct {
-    /** The bit mask corresponding to the walls; a wall is open if its bit is
-        set */
-    unsigned char walls;
+    /** The order in which to store the rooms */
+    MazeLayout layout;
 
-    /** The data of the room */
-    void *data;
-} Room;
+    /** The allocator used for all memory of the maze, or NULL to use malloc;
+        it is copied into the maze */
+    const MazeAllocator *allocator;
+
+    /** A combination of the MAZE_CREATE_* flags */
+    unsigned int flags;
+} MazeCreateOptions;
+
+/**
+ * The number of bytes of the walls array in a page of a snapshot; this is 64
+ * tiles for MAZE_LAYOUT_TILES.
+ */
+#define MAZE_SNAPSHOT_PAGE_SIZE 4096
 
 /**
  * The structure of a maze instance.
+ *
+ * The walls and the data of the rooms are stored in separate arrays, so that
+ * the walls of many rooms fit in a single cache line.
+ *
+ * The walls array is surrounded by a ring of edge rooms, so that the rooms
+ * just outside of the maze can be read without special cases; use maze_index
+ * to find a room in it.
+ *
+ * Coordinates are int, so the width and height are at most INT_MAX, but all
+ * indices are size_t, so the number of rooms is only limited by memory.
  */
 typedef struct {
     /** The width of the maze */
@@ -71,8 +149,39 @@ typedef struct {
     /** The height of the maze */
     unsigned int height;
 
-    /** The actual maze data; its size is width * height */
-    Room *data;
+    /** The order in which the walls are stored */
+    MazeLayout layout;
+
+    /** The bit masks corresponding to the walls of the rooms, including the
+        edge rooms; a wall is open if its bit is set. Its size is
+        (width + 2) * (height + 2), rounded up to whole tiles for
+        MAZE_LAYOUT_TILES */
+    unsigned char *walls;
+
+    /** The data of the rooms; its size is width * height. This is NULL until
+        data is first set for a room */
+    void **data;
+
+    /** The allocator of the maze */
+    MazeAllocator allocator;
+
+    /** The size of the walls array in bytes */
+    size_t walls_size;
+
+    /** The memory mapping containing the walls array and its size, or NULL if
+        the walls array is allocated together with the maze. For mazes
+        returned by maze_map, this is a read-only mapping of the file */
+    void *mapping;
+    size_t mapping_size;
+
+    /** One bit for every MAZE_SNAPSHOT_PAGE_SIZE bytes of the walls array,
+        set if the page has been modified since the last snapshot. This is
+        NULL until the first snapshot is taken. The bits are set atomically,
+        so threads may open doors in different rooms concurrently */
+    uint64_t *dirty;
+
+    /** The last snapshot taken of the maze, or NULL */
+    struct MazeSnapshot *snapshot;
 } Maze;
 
 
@@ -85,11 +194,66 @@ typedef struct {
  *     The width of the maze.
  * @param height
  *     The height of the maze.
- * @return a new maze with no walls open
+ * @return a new maze with no walls open, or NULL if memory could not be
+ *     allocated
  */
 Maze*
 maze_create(unsigned int width, unsigned int height);
 
+/**
+ * Creates a maze of the specific dimensions with a specific storage order.
+ *
+ * The layout is transparent to all functions operating on the maze; it only
+ * affects which rooms share cache lines.
+ *
+ * @param width
+ *     The width of the maze.
+ * @param height
+ *     The height of the maze.
+ * @param layout
+ *     The order in which to store the rooms.
+ * @return a new maze with no walls open, or NULL if memory could not be
+ *     allocated
+ */
+Maze*
+maze_create_layout(unsigned int width, unsigned int height,
+    MazeLayout layout);
+
+/**
+ * Creates a maze of the specific dimensions with specific options.
+ *
+ * @param width
+ *     The width of the maze.
+ * @param height
+ *     The height of the maze.
+ * @param options
+ *     The options, or NULL to use the defaults of maze_create.
+ * @return a new maze with no walls open, or NULL if memory could not be
+ *     allocated, the width or height is greater than INT_MAX or the size of
+ *     the maze does not fit in memory
+ */
+Maze*
+maze_create_ex(unsigned int width, unsigned int height,
+    const MazeCreateOptions *options);
+
+/**
+ * Calculates the size of the walls array of a maze.
+ *
+ * @param width
+ *     The width of the maze.
+ * @param height
+ *     The height of the maze.
+ * @param layout
+ *     The order in which the rooms are stored.
+ * @param size
+ *     The size in bytes. This is only set if the function succeeds.
+ * @return non-zero if the width and height are valid and the size fits in a
+ *     size_t
+ */
+int
+maze_walls_size(unsigned int width, unsigned int height, MazeLayout layout,
+    size_t *size);
+
 /**
  * Frees all resources allocated by the maze.
  *
@@ -99,6 +263,69 @@ maze_create(unsigned int width, unsigned int height);
 void
 maze_free(Maze *maze);
 
+/**
+ * Allocates the data array of a maze.
+ *
+ * This is done automatically by maze_data_set, but must be done in advance if
+ * several threads will set data in the same maze.
+ *
+ * @param maze
+ *     The maze.
+ * @return non-zero if the data array was allocated or already existed
+ */
+int
+maze_data_allocate(Maze *maze);
+
+/**
+ * Recalculates the edge rooms from the rooms along the edge of a maze.
+ *
+ * maze_door_open keeps the edge rooms up to date; this is only required after
+ * writing to the walls array directly. Since direct writes are not tracked,
+ * this marks the whole maze as modified for the next snapshot.
+ *
+ * @param maze
+ *     The maze.
+ */
+void
+maze_edge_update(Maze *maze);
+
+/**
+ * Reads the walls of consecutive rooms in a row.
+ *
+ * @param maze
+ *     The maze.
+ * @param x, y
+ *     The coordinates of the first room. The rooms may include edge rooms.
+ * @param width
+ *     The number of rooms to read.
+ * @param buffer
+ *     A buffer of width bytes that is used if the rooms are not stored
+ *     consecutively.
+ * @return the walls of the rooms, either in the maze or in buffer
+ */
+const unsigned char*
+maze_row_read(Maze *maze, int x, int y, unsigned int width,
+    unsigned char *buffer);
+
+/**
+ * Opens doors in consecutive rooms in a row.
+ *
+ * The walls are combined with the current walls of the rooms. The edge rooms
+ * are not updated.
+ *
+ * @param maze
+ *     The maze.
+ * @param x, y
+ *     The coordinates of the first room.
+ * @param width
+ *     The number of rooms to update.
+ * @param walls
+ *     The walls to open in every room.
+ */
+void
+maze_row_merge(Maze *maze, int x, int y, unsigned int width,
+    const unsigned char *walls);
+
 /**
  * Opens a door in a room.
  *
@@ -179,25 +406,41 @@ typedef void* (*MazeInitializeCallback)(void *context, Maze *maze, int x, int y,
 
 
 /**
- * Data used by the Randomised Prim algorithm.
+ * A wall waiting to be opened by the Randomised Prim algorithm.
  */
-typedef struct RandomizedPrimData RandomizedPrimData;
-struct RandomizedPrimData {
+typedef struct {
     /** The coordinates of the room */
     int x, y;
 
     /** One of the MAZE_WALL_* macros */
     unsigned char wall;
+} RandomizedPrimWall;
 
-    /** The next wall entry */
-    RandomizedPrimData *next;
-};
+/**
+ * Data used by the Randomised Prim algorithm.
+ *
+ * This is the frontier of the maze; every wall in it leads from a room in the
+ * maze to a room that had not been added when the wall was pushed. The room
+ * may have been added since through another wall, in which case the wall is
+ * skipped when it is picked.
+ */
+typedef struct {
+    /** The walls waiting to be opened */
+    RandomizedPrimWall *walls;
+
+    /** The number of items in walls */
+    size_t count;
+} RandomizedPrimData;
 
 /**
  * Initialises the maze with the Randomised Prim algorithm.
  *
  * When this function is used, the initialize_data sent to the callback will be
- * a RandomizedPrimData* list that contains all walls waiting to be opened.
+ * a RandomizedPrimData* that contains all walls waiting to be opened. It is
+ * only valid for the duration of the callback.
+ *
+ * The random number generator is seeded with rand(), so the result is
+ * determined by srand().
  *
  * @param maze
  *     The maze to initialise.
@@ -212,6 +455,548 @@ void
 maze_initialize_randomized_prim(Maze *maze, MazeInitializeCallback callback,
     void *context);
 
+/**
+ * Initialises the maze with the Randomised Prim algorithm using a specific
+ * random number generator.
+ *
+ * This function does not touch any global state, so several mazes may be
+ * initialised concurrently as long as they use different random number
+ * generators. The same generator state always yields the same maze.
+ *
+ * @param maze
+ *     The maze to initialise.
+ * @param random
+ *     The random number generator to use. It is advanced by this function.
+ * @param callback
+ *     The callback function to use. Its return value is used as the data bits
+ *     for the room at (x, y). This may be NULL, in which case all data fields
+ *     will be NULL.
+ * @param context
+ *     The user context passed to the callback function.
+ * @see maze_initialize_randomized_prim
+ */
+void
+maze_initialize_randomized_prim_r(Maze *maze, MazeRandom *random,
+    MazeInitializeCallback callback, void *context);
+
+/**
+ * Initialises a rectangular area of the maze with the Randomised Prim
+ * algorithm.
+ *
+ * Only doors between rooms inside of the area are opened, so the area becomes
+ * a perfect maze of its own. Rooms outside of the area are not touched.
+ *
+ * @param maze
+ *     The maze to initialise.
+ * @param random
+ *     The random number generator to use. It is advanced by this function.
+ * @param x, y
+ *     The coordinates of the top left room of the area.
+ * @param width, height
+ *     The dimensions of the area. The area must lie completely within the
+ *     maze, otherwise nothing is done.
+ * @param callback
+ *     The callback function to use. Its return value is used as the data bits
+ *     for the room at (x, y). This may be NULL, in which case all data fields
+ *     will be NULL.
+ * @param context
+ *     The user context passed to the callback function.
+ * @return non-zero unless memory could not be allocated
+ * @see maze_initialize_randomized_prim
+ */
+int
+maze_initialize_randomized_prim_region(Maze *maze, MazeRandom *random,
+    int x, int y, unsigned int width, unsigned int height,
+    MazeInitializeCallback callback, void *context);
+
+
+/**
+ * Initialises the maze with the Randomised Kruskal algorithm.
+ *
+ * All doors between rooms are shuffled, and then every door that joins two
+ * rooms not yet connected is opened. This yields mazes with many short dead
+ * ends.
+ *
+ * When this function is used, the callback is called once for every room after
+ * all doors have been opened, and initialize_data is always NULL.
+ *
+ * The random number generator is seeded with rand(), so the result is
+ * determined by srand().
+ *
+ * @param maze
+ *     The maze to initialise.
+ * @param callback
+ *     The callback function to use. Its return value is used as the data bits
+ *     for the room at (x, y). This may be NULL, in which case all data fields
+ *     will be NULL.
+ * @param context
+ *     The user context passed to the callback function.
+ */
+void
+maze_initialize_kruskal(Maze *maze, MazeInitializeCallback callback,
+    void *context);
+
+/**
+ * Initialises the maze with the Randomised Kruskal algorithm using a specific
+ * random number generator.
+ *
+ * @param maze
+ *     The maze to initialise.
+ * @param random
+ *     The random number generator to use. It is advanced by this function.
+ * @param callback
+ *     The callback function to use. This may be NULL.
+ * @param context
+ *     The user context passed to the callback function.
+ * @see maze_initialize_kruskal
+ * @see maze_initialize_randomized_prim_r
+ */
+void
+maze_initialize_kruskal_r(Maze *maze, MazeRandom *random,
+    MazeInitializeCallback callback, void *context);
+
+/**
+ * Initialises a rectangular area of the maze with the Randomised Kruskal
+ * algorithm.
+ *
+ * @param maze
+ *     The maze to initialise.
+ * @param random
+ *     The random number generator to use. It is advanced by this function.
+ * @param x, y
+ *     The coordinates of the top left room of the area.
+ * @param width, height
+ *     The dimensions of the area. The area must lie completely within the
+ *     maze and contain at most 2^31 rooms, otherwise nothing is done; use
+ *     maze_initialize_tiled for larger mazes.
+ * @param callback
+ *     The callback function to use. This may be NULL.
+ * @param context
+ *     The user context passed to the callback function.
+ * @return non-zero unless the area contains too many rooms or memory could
+ *     not be allocated
+ * @see maze_initialize_kruskal
+ * @see maze_initialize_randomized_prim_region
+ */
+int
+maze_initialize_kruskal_region(Maze *maze, MazeRandom *random,
+    int x, int y, unsigned int width, unsigned int height,
+    MazeInitializeCallback callback, void *context);
+
+/**
+ * The identifiers of the built-in maze generators.
+ *
+ * These values are stable, and may be stored.
+ */
+enum {
+    MAZE_GENERATOR_ID_RANDOMIZED_PRIM = 1,
+    MAZE_GENERATOR_ID_KRUSKAL = 2,
+    MAZE_GENERATOR_ID_BACKTRACKER = 3,
+    MAZE_GENERATOR_ID_WILSON = 4,
+    MAZE_GENERATOR_ID_BINARY_TREE = 5,
+    MAZE_GENERATOR_ID_SIDEWINDER = 6
+};
+
+/**
+ * A description of a maze generation algorithm.
+ */
+typedef struct {
+    /** A unique identifier; one of the MAZE_GENERATOR_ID_* constants for the
+        built-in generators */
+    unsigned int id;
+
+    /** The name of the algorithm */
+    const char *name;
+
+    /**
+     * Initialises a rectangular area of a maze.
+     *
+     * Only doors between rooms inside of the area are opened, and the area
+     * becomes a perfect maze.
+     *
+     * @param maze
+     *     The maze to initialise.
+     * @param random
+     *     The random number generator to use.
+     * @param x, y
+     *     The coordinates of the top left room of the area.
+     * @param width, height
+     *     The dimensions of the area. If the area does not lie completely
+     *     within the maze, nothing is done.
+     * @param callback
+     *     The callback function to use. This may be NULL.
+     * @param context
+     *     The user context passed to the callback function.
+     * @return non-zero unless memory could not be allocated
+     */
+    int (*initialize_region)(Maze *maze, MazeRandom *random,
+        int x, int y, unsigned int width, unsigned int height,
+        MazeInitializeCallback callback, void *context);
+
+    /**
+     * Starts initialising a rectangular area of a maze incrementally.
+     *
+     * This is NULL for algorithms that cannot be run incrementally, in which
+     * case step and end are NULL as well.
+     *
+     * @param maze, random, x, y, width, height, callback, context
+     *     The same as for initialize_region, except that the area must lie
+     *     within the maze and must not be empty. The random number generator
+     *     must remain valid until end is called.
+     * @return the state of the initialisation, or NULL if memory could not be
+     *     allocated
+     */
+    void* (*begin)(Maze *maze, MazeRandom *random,
+        int x, int y, unsigned int width, unsigned int height,
+        MazeInitializeCallback callback, void *context);
+
+    /**
+     * Continues an incremental initialisation.
+     *
+     * @param state
+     *     The state returned by begin.
+     * @param max_rooms
+     *     The maximum number of rooms to add. The work performed is
+     *     proportional to this value.
+     * @param rooms
+     *     Incremented by the number of rooms added.
+     * @return non-zero if the area is not yet complete
+     */
+    int (*step)(void *state, unsigned int max_rooms, size_t *rooms);
+
+    /**
+     * Releases the state of an incremental initialisation.
+     *
+     * @param state
+     *     The state returned by begin.
+     */
+    void (*end)(void *state);
+} MazeGeneratorType;
+
+/**
+ * The Randomised Prim algorithm.
+ *
+ * @see maze_initialize_randomized_prim
+ */
+extern const MazeGeneratorType MAZE_GENERATOR_RANDOMIZED_PRIM;
+
+/**
+ * The Randomised Kruskal algorithm.
+ *
+ * @see maze_initialize_kruskal
+ */
+extern const MazeGeneratorType MAZE_GENERATOR_KRUSKAL;
+
+/**
+ * The Recursive Backtracker algorithm.
+ *
+ * This performs a random walk that backs up whenever it reaches a dead end,
+ * and yields mazes with long corridors and few branches. The path is kept in
+ * a preallocated stack of two bit directions, so it needs only three bits of
+ * memory per room.
+ *
+ * The callback is called when a room is first entered, and initialize_data is
+ * always NULL.
+ */
+extern const MazeGeneratorType MAZE_GENERATOR_BACKTRACKER;
+
+/**
+ * Wilson's algorithm.
+ *
+ * Unlike the other generators, this yields a uniform spanning tree: every
+ * possible perfect maze is equally likely. Rooms are added with loop-erased
+ * random walks that are recorded in one scratch byte per room.
+ *
+ * The callback is called when a room is added to the maze, and
+ * initialize_data is always NULL.
+ */
+extern const MazeGeneratorType MAZE_GENERATOR_WILSON;
+
+/**
+ * The Binary Tree algorithm.
+ *
+ * Every room opens the door up or the door to the left, so the maze has a
+ * strong diagonal bias and open corridors along the top and left edges. It is
+ * generated row by row from bulk random bits without branching per room, and
+ * is the fastest generator.
+ *
+ * The callback is called for every room after all doors have been opened, and
+ * initialize_data is always NULL.
+ */
+extern const MazeGeneratorType MAZE_GENERATOR_BINARY_TREE;
+
+/**
+ * The Sidewinder algorithm.
+ *
+ * Every row is split into horizontal runs, each of which has a single door
+ * up, so the maze has an open corridor along the top edge and a vertical bias.
+ * It is generated row by row from bulk random bits.
+ *
+ * The callback is called for every room after all doors have been opened, and
+ * initialize_data is always NULL.
+ */
+extern const MazeGeneratorType MAZE_GENERATOR_SIDEWINDER;
+
+/**
+ * Options for maze_initialize.
+ */
+typedef struct {
+    /** The random number generator to use; if this is NULL, a generator
+        seeded with rand() is used */
+    MazeRandom *random;
+
+    /** The callback function to use; this may be NULL */
+    MazeInitializeCallback callback;
+
+    /** The user context passed to the callback function */
+    void *context;
+} MazeInitializeOptions;
+
+/**
+ * Finds a built-in maze generator by name.
+ *
+ * @param name
+ *     The name of the generator.
+ * @return the generator, or NULL if no generator has the name
+ */
+const MazeGeneratorType*
+maze_generator_type_find(const char *name);
+
+/**
+ * Finds a built-in maze generator by identifier.
+ *
+ * @param id
+ *     The identifier of the generator.
+ * @return the generator, or NULL if no generator has the identifier
+ */
+const MazeGeneratorType*
+maze_generator_type_get(unsigned int id);
+
+/**
+ * Initialises the maze with a specific algorithm.
+ *
+ * @param maze
+ *     The maze to initialise.
+ * @param type
+ *     The algorithm to use.
+ * @param options
+ *     The options. This may be NULL, in which case the defaults are used.
+ * @return non-zero if the maze was initialised, and 0 if memory could not be
+ *     allocated or the maze is too large for the algorithm, in which case the
+ *     maze may be partially initialised
+ * @see MazeGeneratorType.initialize_region
+ */
+int
+maze_initialize(Maze *maze, const MazeGeneratorType *type,
+    const MazeInitializeOptions *options);
+
+
+/**
+ * The state of an incremental maze initialisation.
+ */
+typedef struct MazeGenerator MazeGenerator;
+
+/**
+ * Starts initialising a maze incrementally.
+ *
+ * No doors are opened until maze_generator_step is called. The maze may be
+ * read, for example to render it, between the steps, but it must not be
+ * modified.
+ *
+ * @param maze
+ *     The maze to initialise.
+ * @param type
+ *     The algorithm to use. If it cannot be run incrementally, the complete
+ *     maze is initialised by the first step.
+ * @param options
+ *     The options. This may be NULL, in which case the defaults are used. A
+ *     random number generator passed in the options must remain valid until
+ *     the generator is freed.
+ * @return a new generator, or NULL if memory could not be allocated
+ */
+MazeGenerator*
+maze_generator_begin(Maze *maze, const MazeGeneratorType *type,
+    const MazeInitializeOptions *options);
+
+/**
+ * Continues initialising a maze.
+ *
+ * @param generator
+ *     The generator.
+ * @param max_rooms
+ *     The maximum number of rooms to add. The time spent is proportional to
+ *     this value.
+ * @return non-zero if the maze is not yet complete; this is 0 as well if the
+ *     algorithm failed, which maze_generator_failed reports
+ */
+int
+maze_generator_step(MazeGenerator *generator, unsigned int max_rooms);
+
+/**
+ * Continues initialising a maze for a limited time.
+ *
+ * Rooms are added in small batches until the time has passed or the maze is
+ * complete.
+ *
+ * @param generator
+ *     The generator.
+ * @param seconds
+ *     The time to spend.
+ * @return non-zero if the maze is not yet complete
+ */
+int
+maze_generator_step_time(MazeGenerator *generator, double seconds);
+
+/**
+ * Calculates how much of a maze has been initialised.
+ *
+ * @param generator
+ *     The generator.
+ * @return a value from 0.0 to 1.0, where 1.0 means that the maze is complete
+ */
+double
+maze_generator_progress(MazeGenerator *generator);
+
+/**
+ * Checks whether an incremental initialisation has failed.
+ *
+ * Algorithms that cannot be run incrementally may fail to allocate memory, or
+ * may not support a maze of the given size. The maze is then left partially
+ * initialised, no more steps are taken and maze_generator_progress no longer
+ * advances.
+ *
+ * @param generator
+ *     The generator.
+ * @return non-zero if the algorithm failed
+ */
+int
+maze_generator_failed(MazeGenerator *generator);
+
+/**
+ * Completes initialising a maze and frees the generator.
+ *
+ * @param generator
+ *     The generator to complete.
+ * @return non-zero if the maze was initialised, and 0 if the algorithm failed
+ * @see maze_generator_failed
+ */
+int
+maze_generator_finish(MazeGenerator *generator);
+
+/**
+ * Frees a generator without completing the maze.
+ *
+ * The rooms added so far remain in the maze.
+ *
+ * @param generator
+ *     The generator to free.
+ */
+void
+maze_generator_free(MazeGenerator *generator);
+
+/**
+ * The time spent in the different phases of maze_initialize_tiled.
+ *
+ * All times are wall clock times in seconds.
+ */
+typedef struct {
+    /** The time spent deriving a random number generator for every tile */
+    double split;
+
+    /** The time spent initialising the tiles */
+    double generate;
+
+    /** The time spent opening doors between tiles */
+    double join;
+} MazeTiledTimings;
+
+/**
+ * Initialises the maze by splitting it into tiles that are initialised in
+ * parallel.
+ *
+ * Every tile is initialised as a perfect maze, using its own random number
+ * generator jumped ahead from random.
+ * The tiles are then joined by opening one door along every edge of a random
+ * spanning tree of the tiles, so the result is a perfect maze as well.
+ *
+ * The result depends only on the state of random and the tile size, not on the
+ * number of threads.
+ *
+ * @param maze
+ *     The maze to initialise.
+ * @param type
+ *     The algorithm used to initialise every tile. If this is NULL, the
+ *     Randomised Prim algorithm is used.
+ * @param random
+ *     The random number generator to use. It is advanced by this function.
+ * @param tile_size
+ *     The width and height of a tile. If this is 0, a default is used.
+ * @param threads
+ *     The number of threads to use. If this is 0, one thread per online
+ *     processor is used.
+ * @param callback
+ *     The callback function to use. Its return value is used as the data bits
+ *     for the room at (x, y). This may be NULL, in which case all data fields
+ *     will be NULL. Note that it may be called concurrently from several
+ *     threads; initialize_data is that of the algorithm used for the tile.
+ * @param context
+ *     The user context passed to the callback function.
+ * @param timings
+ *     The time spent in every phase is stored here. This may be NULL.
+ * @return non-zero if the maze was initialised, and 0 if a resource could not
+ *     be allocated or a tile could not be initialised
+ */
+int
+maze_initialize_tiled(Maze *maze, const MazeGeneratorType *type,
+    MazeRandom *random, unsigned int tile_size, unsigned int threads,
+    MazeInitializeCallback callback, void *context,
+    MazeTiledTimings *timings);
+
+
+/**
+ * The function signature of a row callback used by streaming generators.
+ *
+ * @param context
+ *     The user specified context.
+ * @param y
+ *     The index of the row.
+ * @param walls
+ *     The wall bit masks of the rooms in the row. They use the same format as
+ *     the value returned by maze_room_get. This array is only valid for the
+ *     duration of the callback.
+ * @param width
+ *     The number of rooms in the row.
+ * @return non-zero to continue, or 0 to stop generating rows
+ */
+typedef int (*MazeRowCallback)(void *context, uint64_t y,
+    const unsigned char *walls, unsigned int width);
+
+/**
+ * Generates a maze row by row with Eller's algorithm.
+ *
+ * No maze is allocated; every row is passed to callback as soon as it is
+ * complete, and only a few values per column are kept in memory, so the height
+ * of the maze is not limited by the available memory.
+ *
+ * The rows form a perfect maze.
+ *
+ * @param width
+ *     The width of the maze.
+ * @param height
+ *     The height of the maze.
+ * @param random
+ *     The random number generator to use. It is advanced by this function.
+ * @param callback
+ *     The function that receives every row.
+ * @param context
+ *     The user context passed to the callback function.
+ * @return non-zero if all rows were generated, and 0 if the callback stopped
+ *     the generation or memory could not be allocated
+ */
+int
+maze_stream_eller(unsigned int width, uint64_t height, MazeRandom *random,
+    MazeRowCallback callback, void *context);
+
 
 /**
  * Determines whether a maze contains a room.
@@ -246,48 +1031,52 @@ maze_edge_contains(Maze *maze, int x, int y)
         && y >= -1 && y <= (int)maze->height;
 }
 
+/**
+ * Calculates the index of a room in the walls array of a maze.
+ *
+ * @param maze
+ *     The maze on which to operate.
+ * @param x, y
+ *     The coordinates of the room. These must be within the maze or on its
+ *     edge.
+ * @return the index of the room
+ */
+static inline size_t
+maze_index(Maze *maze, int x, int y)
+{
+    if (maze->layout == MAZE_LAYOUT_TILES) {
+        unsigned int tx = x + 1, ty = y + 1;
+        size_t tiles_x = (maze->width + 2 + 7) >> 3;
+
+        return (((ty >> 3) * tiles_x + (tx >> 3)) << 6)
+            | ((ty & 7) << 3) | (tx & 7);
+    }
+
+    return (size_t)(y + 1) * (maze->width + 2) + (x + 1);
+}
+
 /**
  * Retrieves the wall value of a room.
  *
+ * The rooms on the edge of the maze have all doors open except for the one
+ * leading into the maze, which is open only if the corresponding door of the
+ * room inside is open.
+ *
  * @param maze
  *     The maze on which to operate.
  * @param x, y
  *     The coordinates of the room.
- * @return the value of the room, or 0 if the room is invalid
+ * @return the value of the room, or MAZE_WALL_ANY if the room is outside of
+ *     the maze and its edge
  */
 static inline unsigned char
 maze_room_get(Maze *maze, int x, int y)
 {
-    if (maze_contains(maze, x, y)) {
-        return maze->data[y * maze->width + x].walls;
-    }
-    else if (x == -1 && maze_contains(maze, 0, y)) {
-        return MAZE_WALL_ANY
-            & ~(maze->data[y * maze->width + 0].walls
-                    & MAZE_WALL_LEFT
-                ? 0
-                : MAZE_WALL_RIGHT);
-    }
-    else if (x == maze->width && maze_contains(maze, maze->width - 1, y)) {
-        return MAZE_WALL_ANY
-            & ~(maze->data[y * maze->width + maze->width - 1].walls
-                    & MAZE_WALL_RIGHT
-                ? 0
-                : MAZE_WALL_LEFT);
-    }
-    else if (y == -1 && maze_contains(maze, x, 0)) {
-        return MAZE_WALL_ANY
-            & ~(maze->data[0 * maze->width + x].walls
-                    & MAZE_WALL_UP
-                ? 0
-                : MAZE_WALL_DOWN);
-    }
-    else if (y == maze->height && maze_contains(maze, x, maze->height - 1)) {
-        return MAZE_WALL_ANY
-            & ~(maze->data[(maze->height - 1) * maze->width + x].walls
-                    & MAZE_WALL_DOWN
-                ? 0
-                : MAZE_WALL_UP);
+    /* The edge rooms are stored, so a single unsigned comparison per
+       dimension is enough */
+    if ((unsigned int)x + 1 < maze->width + 2
+            && (unsigned int)y + 1 < maze->height + 2) {
+        return maze->walls[maze_index(maze, x, y)];
     }
 
     return MAZE_WALL_ANY;
@@ -305,8 +1094,8 @@ maze_room_get(Maze *maze, int x, int y)
 static inline void*
 maze_data_get(Maze *maze, int x, int y)
 {
-    if (maze_contains(maze, x, y)) {
-        return maze->data[y * maze->width + x].data;
+    if (maze_contains(maze, x, y) && maze->data) {
+        return maze->data[(size_t)y * maze->width + x];
     }
 
     return NULL;
@@ -315,6 +1104,8 @@ maze_data_get(Maze *maze, int x, int y)
 /**
  * Sets the data of a room.
  *
+ * The data array is allocated when the first non-NULL value is set.
+ *
  * @param maze
  *     The maze on which to operate.
  * @param x, y
@@ -326,12 +1117,17 @@ maze_data_get(Maze *maze, int x, int y)
 static inline int
 maze_data_set(Maze *maze, int x, int y, void *data)
 {
-    if (maze_contains(maze, x, y)) {
-        maze->data[y * maze->width + x].data = data;
-        return 1;
+    if (!maze_contains(maze, x, y)) {
+        return 0;
+    }
+
+    /* Rooms without a data array have NULL data already */
+    if (!maze->data && (!data || !maze_data_allocate(maze))) {
+        return !data;
     }
+    maze->data[(size_t)y * maze->width + x] = data;
 
-    return 0;
+    return 1;
 }
 
 /**
@@ -407,9 +1203,8 @@ maze_data_set(Maze *maze, int x, int y, void *data)
  *     The coordinates of the room.
  * @return non-zero if the room has a corner
  */
-#define maze_is_corner_up_left(maze, x, y) (1 \
-    && !maze_is_open_up(maze, x, y) \
-    && !maze_is_open_left(maze, x, y))
+#define maze_is_corner_up_left(maze, x, y) \
+    (!(maze_room_get(maze, x, y) & MAZE_CORNER_UP_LEFT))
 
 /**
  * @see maze_is_corner_up_left
@@ -425,9 +1220,8 @@ maze_data_set(Maze *maze, int x, int y, void *data)
  *     The coordinates of the room.
  * @return non-zero if the room has a corner
  */
-#define maze_is_corner_up_right(maze, x, y) (1 \
-    && !maze_is_open_up(maze, x, y) \
-    && !maze_is_open_right(maze, x, y))
+#define maze_is_corner_up_right(maze, x, y) \
+    (!(maze_room_get(maze, x, y) & MAZE_CORNER_UP_RIGHT))
 
 /**
  * @see maze_is_corner_up_right
@@ -443,9 +1237,8 @@ maze_data_set(Maze *maze, int x, int y, void *data)
  *     The coordinates of the room.
  * @return non-zero if the room has a corner
  */
-#define maze_is_corner_down_left(maze, x, y) (1 \
-    && !maze_is_open_down(maze, x, y) \
-    && !maze_is_open_left(maze, x, y))
+#define maze_is_corner_down_left(maze, x, y) \
+    (!(maze_room_get(maze, x, y) & MAZE_CORNER_DOWN_LEFT))
 
 /**
  * @see maze_is_corner_down_left
@@ -461,9 +1254,8 @@ maze_data_set(Maze *maze, int x, int y, void *data)
  *     The coordinates of the room.
  * @return non-zero if the room has a corner
  */
-#define maze_is_corner_down_right(maze, x, y) (1 \
-    && !maze_is_open_down(maze, x, y) \
-    && !maze_is_open_right(maze, x, y))
+#define maze_is_corner_down_right(maze, x, y) \
+    (!(maze_room_get(maze, x, y) & MAZE_CORNER_DOWN_RIGHT))
 
 /**
  * @see maze_is_corner_down_right
@@ -480,11 +1272,11 @@ maze_data_set(Maze *maze, int x, int y, void *data)
  * @return non-zero if the room has a protruding corner
  */
 #define maze_is_corner_up_left_out(maze, x, y) (1 \
-    && maze_is_open_up(maze, x, y) \
-    && maze_is_open_left(maze, x, y) \
-    && (0 \
-        || !maze_is_open_up(maze, x - 1, y) \
-        || !maze_is_open_left(maze, x, y - 1)))
+    & ((maze_room_get(maze, x, y) & MAZE_CORNER_UP_LEFT) \
+        == MAZE_CORNER_UP_LEFT) \
+    & (0 \
+        | !maze_is_open_up(maze, x - 1, y) \
+        | !maze_is_open_left(maze, x, y - 1)))
 
 /**
  * @see maze_is_corner_up_left_out
@@ -501,11 +1293,11 @@ maze_data_set(Maze *maze, int x, int y, void *data)
  * @return non-zero if the room has a protruding corner
  */
 #define maze_is_corner_up_right_out(maze, x, y) (1 \
-    && maze_is_open_up(maze, x, y) \
-    && maze_is_open_right(maze, x, y) \
-    && (0 \
-        || !maze_is_open_up(maze, x + 1, y) \
-        || !maze_is_open_right(maze, x, y - 1)))
+    & ((maze_room_get(maze, x, y) & MAZE_CORNER_UP_RIGHT) \
+        == MAZE_CORNER_UP_RIGHT) \
+    & (0 \
+        | !maze_is_open_up(maze, x + 1, y) \
+        | !maze_is_open_right(maze, x, y - 1)))
 
 /**
  * @see maze_is_corner_up_right_out
@@ -522,11 +1314,11 @@ maze_data_set(Maze *maze, int x, int y, void *data)
  * @return non-zero if the room has a protruding corner
  */
 #define maze_is_corner_down_left_out(maze, x, y) (1 \
-    && maze_is_open_down(maze, x, y) \
-    && maze_is_open_left(maze, x, y) \
-    && (0 \
-        || !maze_is_open_down(maze, x - 1, y) \
-        || !maze_is_open_left(maze, x, y + 1)))
+    & ((maze_room_get(maze, x, y) & MAZE_CORNER_DOWN_LEFT) \
+        == MAZE_CORNER_DOWN_LEFT) \
+    & (0 \
+        | !maze_is_open_down(maze, x - 1, y) \
+        | !maze_is_open_left(maze, x, y + 1)))
 
 /**
  * @see maze_is_corner_down_left_out
@@ -543,11 +1335,11 @@ maze_data_set(Maze *maze, int x, int y, void *data)
  * @return non-zero if the room has a protruding corner
  */
 #define maze_is_corner_down_right_out(maze, x, y) (1 \
-    && maze_is_open_down(maze, x, y) \
-    && maze_is_open_right(maze, x, y) \
-    && (0 \
-        || !maze_is_open_down(maze, x + 1, y) \
-        || !maze_is_open_right(maze, x, y + 1)))
+    & ((maze_room_get(maze, x, y) & MAZE_CORNER_DOWN_RIGHT) \
+        == MAZE_CORNER_DOWN_RIGHT) \
+    & (0 \
+        | !maze_is_open_down(maze, x + 1, y) \
+        | !maze_is_open_right(maze, x, y + 1)))
 
 /**
  * @see maze_is_corner_down_right_out
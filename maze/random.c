@@ -0,0 +1,67 @@
+#include "maze-random.h"
+
+/**
+ * Advances a random number generator by the number of steps encoded in a jump
+ * polynomial.
+ *
+ * @param random
+ *     The random number generator to advance.
+ * @param polynomial
+ *     The jump polynomial.
+ */
+static void
+jump(MazeRandom *random, const uint64_t polynomial[4])
+{
+    uint64_t s[4] = {0, 0, 0, 0};
+    int i, b, j;
+
+    for (i = 0; i < 4; i++) {
+        for (b = 0; b < 64; b++) {
+            if (polynomial[i] & ((uint64_t)1 << b)) {
+                for (j = 0; j < 4; j++) {
+                    s[j] ^= random->state[j];
+                }
+            }
+            maze_random_next(random);
+        }
+    }
+
+    for (j = 0; j < 4; j++) {
+        random->state[j] = s[j];
+    }
+}
+
+void
+maze_random_seed(MazeRandom *random, uint64_t seed)
+{
+    int i;
+
+    /* Expand the seed with SplitMix64; this never yields an all zero state */
+    for (i = 0; i < 4; i++) {
+        uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        random->state[i] = z ^ (z >> 31);
+    }
+}
+
+void
+maze_random_jump(MazeRandom *random)
+{
+    static const uint64_t polynomial[4] = {
+        0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+        0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL};
+
+    jump(random, polynomial);
+}
+
+void
+maze_random_long_jump(MazeRandom *random)
+{
+    static const uint64_t polynomial[4] = {
+        0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL,
+        0x77710069854ee241ULL, 0x39109bb02acbe635ULL};
+
+    jump(random, polynomial);
+}
@@ -1,4 +1,6 @@
+#include <limits.h>
 #include <math.h>
+#include <stdint.h>
 
 #include <GL/gl.h>
 
@@ -392,3 +394,42 @@ maze_render_gl(Maze *maze, double wall_width, double slope_width,
 
     return 1;
 }
+
+int
+maze_world_render_gl(MazeWorld *world, double wall_width, double slope_width,
+    double floor_thickness, int cx, int cy, unsigned int d, int flags)
+{
+    Maze *window;
+    int64_t x, y, size;
+    int result;
+
+    if (!world) {
+        return 0;
+    }
+
+    /* Copy the rendered rooms and the ring of rooms around them, since the
+       corners of a room depend on its neighbours; the window must lie within
+       the range of int, and so must its size */
+    x = (int64_t)cx - d - 1;
+    y = (int64_t)cy - d - 1;
+    size = 2 * (int64_t)d + 3;
+    if (size > INT_MAX || x < INT_MIN || x + size - 1 > INT_MAX
+            || y < INT_MIN || y + size - 1 > INT_MAX) {
+        return 0;
+    }
+    window = maze_world_window(world, (int)x, (int)y, (unsigned int)size,
+        (unsigned int)size);
+    if (!window) {
+        return 0;
+    }
+
+    /* maze_render_gl places the room (x, y) of the window at
+       (x, height - 1 - y) */
+    glPushMatrix();
+    glTranslated((double)x, -(double)(y + size - 1), 0.0);
+    result = maze_render_gl(window, wall_width, slope_width, floor_thickness,
+        d + 1, d + 1, d, flags);
+    glPopMatrix();
+
+    return result;
+}
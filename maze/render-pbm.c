@@ -0,0 +1,60 @@
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "maze-render.h"
+
+/**
+ * The number of bytes buffered before they are written.
+ */
+#define BUFFER_SIZE 4096
+
+int
+maze_render_pbm_row(void *context, uint64_t y, const unsigned char *walls,
+    unsigned int width)
+{
+    MazeRenderPbmContext *pbm = context;
+    unsigned char buffer[BUFFER_SIZE];
+    unsigned int dx, dy, x, length, bit;
+
+    if (y == 0 && fprintf(pbm->stream, "P4\n%" PRIu64 " %" PRIu64 "\n",
+            (uint64_t)width * pbm->room_width,
+            pbm->height * pbm->room_height) < 0) {
+        return 0;
+    }
+
+    /* Pixels are packed eight to a byte, most significant bit first, and every
+       line is padded to a whole number of bytes */
+    for (dy = 0; dy < pbm->room_height; dy++) {
+        length = 0;
+        bit = 0;
+        buffer[0] = 0;
+        for (x = 0; x < width; x++) {
+            for (dx = 0; dx < pbm->room_width; dx++) {
+                if (maze_render_is_wall(walls[x], dx, dy,
+                        pbm->room_width, pbm->room_height)) {
+                    buffer[length] |= 0x80 >> bit;
+                }
+
+                if (++bit == 8) {
+                    bit = 0;
+                    if (++length == sizeof(buffer)) {
+                        if (fwrite(buffer, 1, length, pbm->stream) != length) {
+                            return 0;
+                        }
+                        length = 0;
+                    }
+                    buffer[length] = 0;
+                }
+            }
+        }
+
+        if (bit) {
+            length++;
+        }
+        if (fwrite(buffer, 1, length, pbm->stream) != length) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
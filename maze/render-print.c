@@ -2,58 +2,68 @@
 
 #include "maze-render.h"
 
+/**
+ * The number of characters buffered before they are written.
+ */
+#define BUFFER_SIZE 4096
+
 void
 maze_render_print(Maze *maze, unsigned int room_width, unsigned int room_height,
     char wall_char, char floor_char)
 {
-    int x, y;
-
-    for (y = 0; y < maze->height * room_height; y++) {
-        for (x = 0; x < maze->width * room_width; x++) {
-            int rx = x / room_width;
-            int ry = y / room_height;
-            int dx = x % room_width;
-            int dy = y % room_height;
-            char c;
-
-            if (dy == 0) {
-                if (dx == 0 || dx == room_width - 1) {
-                    c = wall_char;
-                }
-                else {
-                    c = maze_is_open_up(maze, rx, ry)
-                        ? floor_char
-                        : wall_char;
-                }
-            }
-            else if (dy == room_height - 1) {
-                if (dx == 0 || dx == room_width - 1) {
-                    c = wall_char;
-                }
-                else {
-                    c = maze_is_open_down(maze, rx, ry)
-                        ? floor_char
-                        : wall_char;
+    unsigned int x, y, dx, dy;
+
+    /* Iterate over rooms rather than characters, so that the size of the
+       output is not limited by the range of an integer */
+    for (y = 0; y < maze->height; y++) {
+        for (dy = 0; dy < room_height; dy++) {
+            for (x = 0; x < maze->width; x++) {
+                unsigned char walls = maze_room_get(maze, x, y);
+
+                for (dx = 0; dx < room_width; dx++) {
+                    printf("%c", maze_render_is_wall(walls, dx, dy,
+                            room_width, room_height)
+                        ? wall_char
+                        : floor_char);
                 }
             }
-            else {
-                if (dx == 0) {
-                    c = maze_is_open_left(maze, rx, ry)
-                        ? floor_char
-                        : wall_char;
-                }
-                else if (dx == room_width - 1) {
-                    c = maze_is_open_right(maze, rx, ry)
-                        ? floor_char
-                        : wall_char;
-                }
-                else {
-                    c = floor_char;
+
+            printf("\n");
+        }
+    }
+}
+
+int
+maze_render_print_row(void *context, uint64_t y, const unsigned char *walls,
+    unsigned int width)
+{
+    MazeRenderPrintContext *print = context;
+    char buffer[BUFFER_SIZE];
+    unsigned int dx, dy, x, length;
+
+    for (dy = 0; dy < print->room_height; dy++) {
+        length = 0;
+        for (x = 0; x < width; x++) {
+            for (dx = 0; dx < print->room_width; dx++) {
+                buffer[length++] = maze_render_is_wall(walls[x], dx, dy,
+                        print->room_width, print->room_height)
+                    ? print->wall_char
+                    : print->floor_char;
+
+                if (length == sizeof(buffer)) {
+                    if (fwrite(buffer, 1, length, print->stream) != length) {
+                        return 0;
+                    }
+                    length = 0;
                 }
             }
-            printf("%c", c);
         }
 
-        printf("\n");
+        buffer[length++] = '\n';
+        if (fwrite(buffer, 1, length, print->stream) != length) {
+            return 0;
+        }
     }
+
+    return 1;
 }
@@ -0,0 +1,314 @@
+#include <string.h>
+
+#include "maze-snapshot.h"
+
+/**
+ * A page of the walls array shared between snapshots.
+ */
+typedef struct {
+    /** The number of snapshots containing the page */
+    size_t references;
+
+    /** The walls; the last page of a maze may only be partially used */
+    unsigned char walls[MAZE_SNAPSHOT_PAGE_SIZE];
+} Page;
+
+struct MazeSnapshot {
+    /** The dimensions and layout of the maze */
+    unsigned int width, height;
+    MazeLayout layout;
+
+    /** The size of the walls array of the maze */
+    size_t walls_size;
+
+    /** The number of holders of the snapshot; a maze holds its last
+        snapshot */
+    size_t references;
+
+    /** The number of pages, and the pages */
+    size_t page_count;
+    Page *pages[];
+};
+
+/**
+ * Calculates the number of bytes of the walls array in a page.
+ *
+ * @param walls_size
+ *     The size of the walls array.
+ * @param page
+ *     The index of the page.
+ * @return the number of bytes
+ */
+static inline size_t
+page_size(size_t walls_size, size_t page)
+{
+    size_t remaining = walls_size - page * MAZE_SNAPSHOT_PAGE_SIZE;
+
+    return remaining < MAZE_SNAPSHOT_PAGE_SIZE
+        ? remaining
+        : MAZE_SNAPSHOT_PAGE_SIZE;
+}
+
+/**
+ * Releases a reference to a page.
+ *
+ * @param page
+ *     The page.
+ */
+static void
+page_release(Page *page)
+{
+    if (--page->references == 0) {
+        free(page);
+    }
+}
+
+/**
+ * Determines whether a page of a maze has been modified since its last
+ * snapshot.
+ *
+ * @param maze
+ *     The maze. It must track modifications.
+ * @param page
+ *     The index of the page.
+ * @return non-zero if the page has been modified
+ */
+static inline int
+is_dirty(Maze *maze, size_t page)
+{
+    return (maze->dirty[page / 64] >> (page % 64)) & 1;
+}
+
+/**
+ * Starts tracking modifications of a maze, if it does not already.
+ *
+ * @param maze
+ *     The maze.
+ * @return non-zero unless memory could not be allocated
+ */
+static int
+track(Maze *maze)
+{
+    if (!maze->dirty) {
+        maze->dirty = maze->allocator.alloc(maze->allocator.context,
+            sizeof(uint64_t) * maze_snapshot_dirty_words(maze));
+    }
+
+    return maze->dirty != NULL;
+}
+
+/**
+ * Finds the position of a room in the walls array of a snapshot.
+ *
+ * @param snapshot
+ *     The snapshot.
+ * @param x, y
+ *     The coordinates of the room, which may be an edge room.
+ * @return the index of the room
+ */
+static inline size_t
+snapshot_index(MazeSnapshot *snapshot, int x, int y)
+{
+    Maze shape;
+
+    /* maze_index only depends on the dimensions and the layout */
+    shape.width = snapshot->width;
+    shape.height = snapshot->height;
+    shape.layout = snapshot->layout;
+
+    return maze_index(&shape, x, y);
+}
+
+/**
+ * Finds the room at a position in the walls array of a snapshot; this is the
+ * inverse of maze_index.
+ *
+ * @param snapshot
+ *     The snapshot.
+ * @param index
+ *     The index in the walls array.
+ * @param x, y
+ *     Receive the coordinates of the room.
+ * @return non-zero if the room lies within the maze, and is not an edge room
+ *     or padding of the last tiles
+ */
+static int
+snapshot_coordinates(MazeSnapshot *snapshot, size_t index, int *x, int *y)
+{
+    size_t tx, ty;
+
+    if (snapshot->layout == MAZE_LAYOUT_TILES) {
+        size_t tiles_x = ((size_t)snapshot->width + 9) >> 3;
+        size_t tile = index >> 6;
+
+        tx = (tile % tiles_x) << 3 | (index & 7);
+        ty = (tile / tiles_x) << 3 | ((index >> 3) & 7);
+    }
+    else {
+        tx = index % ((size_t)snapshot->width + 2);
+        ty = index / ((size_t)snapshot->width + 2);
+    }
+
+    *x = (int)tx - 1;
+    *y = (int)ty - 1;
+
+    return tx - 1 < snapshot->width && ty - 1 < snapshot->height;
+}
+
+MazeSnapshot*
+maze_snapshot_create(Maze *maze)
+{
+    MazeSnapshot *previous = maze->snapshot;
+    MazeSnapshot *result;
+    size_t count = (maze->walls_size + MAZE_SNAPSHOT_PAGE_SIZE - 1)
+        / MAZE_SNAPSHOT_PAGE_SIZE;
+    size_t i;
+
+    result = malloc(sizeof(MazeSnapshot) + sizeof(Page*) * count);
+    if (!result || !track(maze)) {
+        free(result);
+        return NULL;
+    }
+    result->width = maze->width;
+    result->height = maze->height;
+    result->layout = maze->layout;
+    result->walls_size = maze->walls_size;
+    result->page_count = count;
+
+    for (i = 0; i < count; i++) {
+        const unsigned char *walls = maze->walls + i * MAZE_SNAPSHOT_PAGE_SIZE;
+        size_t size = page_size(maze->walls_size, i);
+
+        /* Share unmodified pages, and pages whose modifications did not
+           actually change anything, with the previous snapshot */
+        if (previous && (!is_dirty(maze, i)
+                || memcmp(previous->pages[i]->walls, walls, size) == 0)) {
+            result->pages[i] = previous->pages[i];
+            result->pages[i]->references++;
+            continue;
+        }
+
+        result->pages[i] = malloc(sizeof(Page));
+        if (!result->pages[i]) {
+            while (i-- > 0) {
+                page_release(result->pages[i]);
+            }
+            free(result);
+            return NULL;
+        }
+        result->pages[i]->references = 1;
+        memcpy(result->pages[i]->walls, walls, size);
+    }
+
+    memset(maze->dirty, 0, sizeof(uint64_t) * maze_snapshot_dirty_words(maze));
+    result->references = 2;
+    maze->snapshot = result;
+    maze_snapshot_free(previous);
+
+    return result;
+}
+
+void
+maze_snapshot_free(MazeSnapshot *snapshot)
+{
+    size_t i;
+
+    if (!snapshot || --snapshot->references > 0) {
+        return;
+    }
+
+    for (i = 0; i < snapshot->page_count; i++) {
+        page_release(snapshot->pages[i]);
+    }
+    free(snapshot);
+}
+
+unsigned char
+maze_snapshot_room_get(MazeSnapshot *snapshot, int x, int y)
+{
+    if ((unsigned int)x + 1 < snapshot->width + 2
+            && (unsigned int)y + 1 < snapshot->height + 2) {
+        size_t index = snapshot_index(snapshot, x, y);
+
+        return snapshot->pages[index / MAZE_SNAPSHOT_PAGE_SIZE]
+            ->walls[index % MAZE_SNAPSHOT_PAGE_SIZE];
+    }
+    else {
+        return MAZE_WALL_ANY;
+    }
+}
+
+int
+maze_snapshot_restore(MazeSnapshot *snapshot, Maze *maze)
+{
+    MazeSnapshot *current;
+    size_t i;
+
+    if (maze->width != snapshot->width || maze->height != snapshot->height
+            || maze->layout != snapshot->layout || !track(maze)) {
+        return 0;
+    }
+
+    /* A maze without a snapshot has just started tracking modifications, so
+       all of it must be copied */
+    current = maze->snapshot;
+    for (i = 0; i < snapshot->page_count; i++) {
+        if (!current || is_dirty(maze, i)
+                || current->pages[i] != snapshot->pages[i]) {
+            memcpy(maze->walls + i * MAZE_SNAPSHOT_PAGE_SIZE,
+                snapshot->pages[i]->walls,
+                page_size(snapshot->walls_size, i));
+        }
+    }
+
+    memset(maze->dirty, 0, sizeof(uint64_t) * maze_snapshot_dirty_words(maze));
+    snapshot->references++;
+    maze->snapshot = snapshot;
+    maze_snapshot_free(current);
+
+    return 1;
+}
+
+size_t
+maze_snapshot_diff(MazeSnapshot *a, MazeSnapshot *b,
+    MazeSnapshotDiffCallback callback, void *context)
+{
+    size_t result = 0;
+    size_t i, j;
+
+    for (i = 0; i < a->page_count; i++) {
+        const unsigned char *before = a->pages[i]->walls;
+        const unsigned char *after = b->pages[i]->walls;
+        size_t size = page_size(a->walls_size, i);
+
+        if (before == after) {
+            continue;
+        }
+
+        for (j = 0; j < size; j++) {
+            int x, y;
+
+            if (before[j] != after[j] && snapshot_coordinates(a,
+                    i * MAZE_SNAPSHOT_PAGE_SIZE + j, &x, &y)) {
+                result++;
+                if (callback) {
+                    callback(context, x, y, before[j], after[j]);
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+void
+maze_snapshot_stop(Maze *maze)
+{
+    if (maze->dirty) {
+        maze->allocator.free(maze->allocator.context, maze->dirty,
+            sizeof(uint64_t) * maze_snapshot_dirty_words(maze));
+        maze->dirty = NULL;
+    }
+    maze_snapshot_free(maze->snapshot);
+    maze->snapshot = NULL;
+}
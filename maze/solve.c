@@ -0,0 +1,332 @@
+#include <string.h>
+
+#include "maze-solve.h"
+
+/**
+ * The minimum number of rooms in the queue.
+ */
+#define MIN_QUEUE 1024
+
+/**
+ * Defining MAZE_SOLVE_QUEUE to a power of two fixes the initial number of
+ * rooms in the queue, which is otherwise chosen from the dimensions of the
+ * maze; a small value forces the queue to grow.
+ */
+
+/**
+ * The offsets of the room behind each wall, indexed by the bit of the wall.
+ */
+static const int DX[4] = {-1, 0, 1, 0};
+static const int DY[4] = {0, -1, 0, 1};
+
+/**
+ * For MAZE_LAYOUT_TILES, the bits of an index holding the position within a
+ * tile along the direction of each wall, and their value at the edge of the
+ * tile in that direction.
+ */
+static const size_t TILE_MASKS[4] = {7, 56, 7, 56};
+static const size_t TILE_EDGES[4] = {0, 0, 7, 56};
+
+/**
+ * A room in the queue.
+ */
+typedef struct {
+    /** The coordinates of the room */
+    int x, y;
+
+    /** The index of the room in the walls array */
+    size_t index;
+} Room;
+
+struct MazeSolveWorkspace {
+    /** One bit per room of the walls array, set for visited rooms; all bits
+        are clear between searches */
+    uint64_t *visited;
+    size_t visited_words;
+
+    /** Two bits per room of the walls array, the bit of the wall through
+        which the room was entered */
+    unsigned char *parents;
+    size_t parents_size;
+
+    /** The queue; its capacity is a power of two */
+    Room *queue;
+    size_t queue_capacity;
+
+    /** The steps of the last path */
+    unsigned char *steps;
+    size_t steps_capacity;
+};
+
+/**
+ * Grows an array.
+ *
+ * @param array
+ *     The array, which is reallocated if it is too small.
+ * @param capacity
+ *     The current number of elements, which is updated.
+ * @param required
+ *     The required number of elements.
+ * @param size
+ *     The size of an element.
+ * @return non-zero unless memory could not be allocated
+ */
+static int
+reserve(void **array, size_t *capacity, size_t required, size_t size)
+{
+    void *result;
+
+    if (*capacity >= required) {
+        return 1;
+    }
+
+    result = realloc(*array, required * size);
+    if (!result) {
+        return 0;
+    }
+    *array = result;
+    *capacity = required;
+
+    return 1;
+}
+
+/**
+ * Doubles the capacity of the queue, keeping its rooms in order.
+ *
+ * The rooms are moved to the start of the queue, so the caller must restart
+ * its counters at 0.
+ *
+ * @param workspace
+ *     The workspace.
+ * @param head
+ *     The index of the first room. The queue is full.
+ * @return non-zero unless memory could not be allocated
+ */
+static int
+queue_grow(MazeSolveWorkspace *workspace, size_t head)
+{
+    size_t capacity = workspace->queue_capacity;
+    Room *queue = malloc(2 * capacity * sizeof(Room));
+
+    if (!queue) {
+        return 0;
+    }
+
+    head &= capacity - 1;
+    memcpy(queue, workspace->queue + head, (capacity - head) * sizeof(Room));
+    memcpy(queue + capacity - head, workspace->queue, head * sizeof(Room));
+    free(workspace->queue);
+    workspace->queue = queue;
+    workspace->queue_capacity = 2 * capacity;
+
+    return 1;
+}
+
+MazeSolveWorkspace*
+maze_solve_workspace_create(void)
+{
+    MazeSolveWorkspace *result;
+
+    result = malloc(sizeof(MazeSolveWorkspace));
+    if (!result) {
+        return NULL;
+    }
+    result->visited = NULL;
+    result->visited_words = 0;
+    result->parents = NULL;
+    result->parents_size = 0;
+    result->queue = NULL;
+    result->queue_capacity = 0;
+    result->steps = NULL;
+    result->steps_capacity = 0;
+
+    return result;
+}
+
+void
+maze_solve_workspace_free(MazeSolveWorkspace *workspace)
+{
+    free(workspace->visited);
+    free(workspace->parents);
+    free(workspace->queue);
+    free(workspace->steps);
+    free(workspace);
+}
+
+int
+maze_solve_workspace_reserve(MazeSolveWorkspace *workspace, Maze *maze)
+{
+    size_t words = (maze->walls_size + 63) / 64;
+#ifdef MAZE_SOLVE_QUEUE
+    size_t queue = MAZE_SOLVE_QUEUE;
+#else
+    size_t queue = MIN_QUEUE;
+
+    /* The frontier of a perfect maze is usually small, so start with room
+       for a few rows and columns and only grow for open mazes */
+    while (queue < 4 * ((size_t)maze->width + maze->height + 4)) {
+        queue <<= 1;
+    }
+#endif
+
+    /* The visited set must be clear, and the queue must keep a power of two
+       capacity, so neither is reallocated in place */
+    if (workspace->visited_words < words) {
+        free(workspace->visited);
+        workspace->visited = calloc(words, sizeof(uint64_t));
+        workspace->visited_words = workspace->visited ? words : 0;
+        if (!workspace->visited) {
+            return 0;
+        }
+    }
+    if (workspace->queue_capacity < queue) {
+        free(workspace->queue);
+        workspace->queue = malloc(queue * sizeof(Room));
+        workspace->queue_capacity = workspace->queue ? queue : 0;
+        if (!workspace->queue) {
+            return 0;
+        }
+    }
+
+    return reserve((void**)&workspace->parents, &workspace->parents_size,
+        (maze->walls_size + 3) / 4, 1);
+}
+
+int
+maze_solve(Maze *maze, int sx, int sy, int tx, int ty,
+    MazeSolveWorkspace *workspace, MazePath *path)
+{
+    uint64_t *visited;
+    unsigned char *parents;
+    size_t stride = (size_t)maze->width + 2;
+    size_t row = ((stride + 7) >> 3) << 6;
+    size_t offsets[4], crossings[4];
+    size_t start, target, low, high, head, tail, length, i;
+    int found, x, y;
+
+    if (!maze_edge_contains(maze, sx, sy) || !maze_edge_contains(maze, tx, ty)
+            || !maze_solve_workspace_reserve(workspace, maze)) {
+        return 0;
+    }
+    visited = workspace->visited;
+    parents = workspace->parents;
+
+    /* The offsets of the neighbours of a room; moving left or up wraps
+       around. For MAZE_LAYOUT_TILES, the position of a room within its 8x8
+       tile is stored in the low 6 bits of its index, so a step is an offset
+       within the tile unless it crosses the edge of the tile */
+    if (maze->layout == MAZE_LAYOUT_TILES) {
+        offsets[0] = (size_t)-1;
+        offsets[1] = (size_t)-8;
+        offsets[2] = 1;
+        offsets[3] = 8;
+        crossings[0] = (size_t)-57;
+        crossings[1] = 56 - row;
+        crossings[2] = 57;
+        crossings[3] = row - 56;
+    }
+    else {
+        offsets[0] = crossings[0] = (size_t)-1;
+        offsets[1] = crossings[1] = -stride;
+        offsets[2] = crossings[2] = 1;
+        offsets[3] = crossings[3] = stride;
+    }
+
+    start = maze_index(maze, sx, sy);
+    target = maze_index(maze, tx, ty);
+    visited[start / 64] |= (uint64_t)1 << (start % 64);
+    low = high = start;
+    workspace->queue[0].x = sx;
+    workspace->queue[0].y = sy;
+    workspace->queue[0].index = start;
+    head = 0;
+    tail = 1;
+    found = start == target;
+
+    /* Breadth first search, stopping as soon as the target is reached */
+    while (!found && head != tail) {
+        Room room = workspace->queue[head++ & (workspace->queue_capacity - 1)];
+        unsigned int open = maze->walls[room.index];
+
+        /* Only the edge rooms have doors leading out of the walls array */
+        if (!maze_contains(maze, room.x, room.y)) {
+            open &= (room.x >= 0 ? MAZE_WALL_LEFT : 0)
+                | (room.y >= 0 ? MAZE_WALL_UP : 0)
+                | (room.x < (int)maze->width ? MAZE_WALL_RIGHT : 0)
+                | (room.y < (int)maze->height ? MAZE_WALL_DOWN : 0);
+        }
+
+        while (open) {
+            int d = __builtin_ctz(open);
+            int nx = room.x + DX[d];
+            int ny = room.y + DY[d];
+            size_t index = room.index
+                + ((room.index & TILE_MASKS[d]) == TILE_EDGES[d]
+                    ? crossings[d]
+                    : offsets[d]);
+            Room *next;
+
+            open &= open - 1;
+            if (visited[index / 64] & ((uint64_t)1 << (index % 64))) {
+                continue;
+            }
+
+            visited[index / 64] |= (uint64_t)1 << (index % 64);
+            parents[index / 4] = (parents[index / 4] & ~(3 << (index % 4 * 2)))
+                | d << (index % 4 * 2);
+            low = index < low ? index : low;
+            high = index > high ? index : high;
+            if (index == target) {
+                found = 1;
+                break;
+            }
+
+            if (tail - head == workspace->queue_capacity) {
+                if (!queue_grow(workspace, head)) {
+                    tail = head;
+                    break;
+                }
+                tail -= head;
+                head = 0;
+            }
+            next = &workspace->queue[tail++ & (workspace->queue_capacity - 1)];
+            next->x = nx;
+            next->y = ny;
+            next->index = index;
+        }
+    }
+
+    /* Only clear the part of the visited set that was used */
+    memset(visited + low / 64, 0,
+        (high / 64 - low / 64 + 1) * sizeof(uint64_t));
+
+    if (!found || !path) {
+        return found;
+    }
+
+    /* Walk back from the target twice; first to find the length of the path,
+       and then to record its steps */
+    length = 0;
+    for (x = tx, y = ty; x != sx || y != sy; length++) {
+        i = maze_index(maze, x, y);
+        x -= DX[(parents[i / 4] >> (i % 4 * 2)) & 3];
+        y -= DY[(parents[i / 4] >> (i % 4 * 2)) & 3];
+    }
+    if (!reserve((void**)&workspace->steps, &workspace->steps_capacity,
+            length ? length : 1, 1)) {
+        return 0;
+    }
+    for (x = tx, y = ty, i = length; i > 0; i--) {
+        size_t index = maze_index(maze, x, y);
+        int d = (parents[index / 4] >> (index % 4 * 2)) & 3;
+
+        workspace->steps[i - 1] = 1 << d;
+        x -= DX[d];
+        y -= DY[d];
+    }
+
+    path->length = length;
+    path->steps = workspace->steps;
+
+    return 1;
+}
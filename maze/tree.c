@@ -0,0 +1,358 @@
+#include <limits.h>
+#include <string.h>
+
+#include "maze-tree.h"
+
+/**
+ * The number of positions of the Euler tour in a block.
+ */
+#define BLOCK_SIZE 32
+
+/**
+ * The maximum number of rooms; the Euler tour must be indexable with 32 bits.
+ */
+#define MAX_ROOMS ((size_t)1 << 31)
+
+/**
+ * Marks a room that has not been visited while building the index.
+ */
+#define UNVISITED UINT32_MAX
+
+/**
+ * The offsets of the room behind each wall, indexed by the bit of the wall.
+ */
+static const int DX[4] = {-1, 0, 1, 0};
+static const int DY[4] = {0, -1, 0, 1};
+
+/**
+ * A room of the tree.
+ */
+typedef struct {
+    /** The first and last positions of the room in the Euler tour */
+    uint32_t first, last;
+
+    /** The depth of the room */
+    uint32_t depth;
+
+    /** The wall leading to the parent of the room, or 0 for the root */
+    uint32_t parent;
+} Room;
+
+/**
+ * A position of the Euler tour.
+ */
+typedef struct {
+    /** The depth of the room at the position */
+    uint32_t depth;
+
+    /** One bit for every position of the block up to this one that is
+        shallower than all following positions up to this one; the shallowest
+        position in a range of a block is the lowest such bit in the range */
+    uint32_t mask;
+} Position;
+
+struct MazeTreeIndex {
+    /** The dimensions of the maze */
+    unsigned int width, height;
+
+    /** The rooms, row by row */
+    Room *rooms;
+
+    /** The Euler tour */
+    Position *tour;
+
+    /** The sparse table over blocks; entry k * blocks + b is the shallowest
+        position in blocks b to b + 2^k - 1 */
+    uint32_t *table;
+    size_t blocks;
+};
+
+/**
+ * Finds the shallowest position of a range within a block.
+ *
+ * @param index
+ *     The index.
+ * @param from, to
+ *     The first and last positions of the range, both in the same block.
+ * @return the shallowest position
+ */
+static inline uint32_t
+block_minimum(MazeTreeIndex *index, uint32_t from, uint32_t to)
+{
+    uint32_t mask = index->tour[to].mask
+        & (UINT32_MAX << (from % BLOCK_SIZE));
+
+    return to - to % BLOCK_SIZE + __builtin_ctz(mask);
+}
+
+/**
+ * Returns the shallower of two positions.
+ */
+static inline uint32_t
+shallower(MazeTreeIndex *index, uint32_t a, uint32_t b)
+{
+    return index->tour[b].depth < index->tour[a].depth ? b : a;
+}
+
+/**
+ * Finds the depth of the lowest common ancestor of two rooms.
+ *
+ * @param index
+ *     The index.
+ * @param a, b
+ *     The rooms.
+ * @return the depth of the lowest common ancestor
+ */
+static inline uint32_t
+ancestor_depth(MazeTreeIndex *index, Room *a, Room *b)
+{
+    uint32_t from = a->first < b->first ? a->first : b->first;
+    uint32_t to = a->first < b->first ? b->first : a->first;
+    uint32_t result;
+    size_t from_block = from / BLOCK_SIZE;
+    size_t to_block = to / BLOCK_SIZE;
+
+    if (from_block == to_block) {
+        return index->tour[block_minimum(index, from, to)].depth;
+    }
+
+    result = shallower(index,
+        block_minimum(index, from, from | (BLOCK_SIZE - 1)),
+        block_minimum(index, to - to % BLOCK_SIZE, to));
+    if (to_block - from_block > 1) {
+        size_t count = to_block - from_block - 1;
+        unsigned int k = 31 - __builtin_clz((unsigned int)count);
+        const uint32_t *level = index->table + k * index->blocks;
+
+        result = shallower(index, result,
+            shallower(index, level[from_block + 1],
+                level[to_block - ((size_t)1 << k)]));
+    }
+
+    return index->tour[result].depth;
+}
+
+/**
+ * Builds the block masks and the sparse table from the Euler tour.
+ *
+ * @param index
+ *     The index, with the depths of its Euler tour.
+ * @param length
+ *     The length of the Euler tour.
+ * @return non-zero unless memory could not be allocated
+ */
+static int
+build_table(MazeTreeIndex *index, size_t length)
+{
+    Position *tour = index->tour;
+    size_t levels, k, b, i;
+
+    /* A monotonic stack of positions within the block, kept as a bit mask */
+    for (i = 0; i < length; i++) {
+        uint32_t mask = i % BLOCK_SIZE ? tour[i - 1].mask : 0;
+
+        while (mask) {
+            unsigned int top = 31 - __builtin_clz(mask);
+
+            if (tour[i - i % BLOCK_SIZE + top].depth < tour[i].depth) {
+                break;
+            }
+            mask &= ~((uint32_t)1 << top);
+        }
+        tour[i].mask = mask | (uint32_t)1 << (i % BLOCK_SIZE);
+    }
+
+    index->blocks = (length + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    for (levels = 1; ((size_t)1 << levels) <= index->blocks; levels++);
+    index->table = malloc(sizeof(uint32_t) * levels * index->blocks);
+    if (!index->table) {
+        return 0;
+    }
+
+    for (b = 0; b < index->blocks; b++) {
+        size_t end = (b + 1) * BLOCK_SIZE < length
+            ? (b + 1) * BLOCK_SIZE
+            : length;
+
+        index->table[b] = block_minimum(index, b * BLOCK_SIZE, end - 1);
+    }
+    for (k = 1; k < levels; k++) {
+        uint32_t *previous = index->table + (k - 1) * index->blocks;
+        uint32_t *current = index->table + k * index->blocks;
+
+        for (b = 0; b + ((size_t)1 << k) <= index->blocks; b++) {
+            current[b] = shallower(index, previous[b],
+                previous[b + ((size_t)1 << (k - 1))]);
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * Walks the tree depth first from the top left room, recording the Euler
+ * tour.
+ *
+ * @param index
+ *     The index.
+ * @param maze
+ *     The maze.
+ * @return non-zero if every room was reached exactly once, which is the case
+ *     for perfect mazes
+ */
+static int
+build_tour(MazeTreeIndex *index, Maze *maze)
+{
+    size_t count = (size_t)maze->width * maze->height;
+    Room *rooms = index->rooms;
+    uint32_t *stack;
+    unsigned char *next;
+    size_t top = 0, position = 0, visited = 1;
+    size_t i;
+
+    stack = malloc(sizeof(uint32_t) * count);
+    next = malloc(count);
+    if (!stack || !next) {
+        free(stack);
+        free(next);
+        return 0;
+    }
+
+    for (i = 0; i < count; i++) {
+        rooms[i].first = UNVISITED;
+    }
+    stack[0] = 0;
+    next[0] = 0;
+    rooms[0].first = 0;
+    rooms[0].depth = 0;
+    rooms[0].parent = 0;
+    index->tour[position++].depth = 0;
+
+    while (top != (size_t)-1) {
+        uint32_t room = stack[top];
+        int x = room % maze->width;
+        int y = room / maze->width;
+        unsigned char wall;
+        uint32_t child;
+
+        /* Return to the parent once all doors have been tried */
+        if (next[top] == 4) {
+            rooms[room].last = position - 1;
+            if (top-- > 0) {
+                index->tour[position++].depth = rooms[stack[top]].depth;
+            }
+            continue;
+        }
+
+        wall = 1 << next[top]++;
+        if (!(maze->walls[maze_index(maze, x, y)] & wall)
+                || wall == rooms[room].parent
+                || !maze_door_enter(maze, &x, &y, wall, 0)
+                || !maze_contains(maze, x, y)) {
+            continue;
+        }
+
+        /* A second way into a room means there is a loop */
+        child = (uint32_t)y * maze->width + x;
+        if (rooms[child].first != UNVISITED) {
+            break;
+        }
+
+        rooms[child].first = position;
+        rooms[child].depth = rooms[room].depth + 1;
+        rooms[child].parent = maze_wall_opposite(wall);
+        index->tour[position++].depth = rooms[child].depth;
+        stack[++top] = child;
+        next[top] = 0;
+        visited++;
+    }
+
+    free(stack);
+    free(next);
+
+    return top == (size_t)-1 && visited == count;
+}
+
+MazeTreeIndex*
+maze_tree_index_create(Maze *maze)
+{
+    MazeTreeIndex *result;
+    size_t count = (size_t)maze->width * maze->height;
+    size_t length = 2 * count - 1;
+
+    if (count == 0 || count > MAX_ROOMS) {
+        return NULL;
+    }
+
+    result = malloc(sizeof(MazeTreeIndex));
+    if (!result) {
+        return NULL;
+    }
+    result->width = maze->width;
+    result->height = maze->height;
+    result->rooms = malloc(sizeof(Room) * count);
+    result->tour = malloc(sizeof(Position) * length);
+    result->table = NULL;
+    if (!result->rooms || !result->tour || !build_tour(result, maze)
+            || !build_table(result, length)) {
+        maze_tree_index_free(result);
+        return NULL;
+    }
+
+    return result;
+}
+
+void
+maze_tree_index_free(MazeTreeIndex *index)
+{
+    free(index->rooms);
+    free(index->tour);
+    free(index->table);
+    free(index);
+}
+
+size_t
+maze_distance(MazeTreeIndex *index, int ax, int ay, int bx, int by)
+{
+    Room *a = &index->rooms[(size_t)ay * index->width + ax];
+    Room *b = &index->rooms[(size_t)by * index->width + bx];
+
+    return (size_t)a->depth + b->depth
+        - 2 * (size_t)ancestor_depth(index, a, b);
+}
+
+unsigned char
+maze_path_next_step(MazeTreeIndex *index, int ax, int ay, int bx, int by)
+{
+    Room *a = &index->rooms[(size_t)ay * index->width + ax];
+    uint32_t position = index->rooms[(size_t)by * index->width + bx].first;
+    int d;
+
+    if (position == a->first) {
+        return 0;
+    }
+
+    /* Unless b lies below a, the path leads up towards the root */
+    if (position < a->first || position > a->last) {
+        return a->parent;
+    }
+
+    /* Otherwise it leads to the child whose part of the tour contains b */
+    for (d = 0; d < 4; d++) {
+        int x = ax + DX[d];
+        int y = ay + DY[d];
+        Room *child;
+
+        if (x < 0 || (unsigned int)x >= index->width
+                || y < 0 || (unsigned int)y >= index->height) {
+            continue;
+        }
+        child = &index->rooms[(size_t)y * index->width + x];
+        if (child->parent == maze_wall_opposite(1 << d)
+                && child->first <= position && position <= child->last) {
+            return 1 << d;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,430 @@
+#include <limits.h>
+#include <stdlib.h>
+
+#include "maze-world.h"
+
+/**
+ * The sides of a chunk, used to derive the position of the door between two
+ * chunks.
+ */
+enum {
+    SIDE_RIGHT = 1,
+    SIDE_DOWN = 2,
+    SIDE_CHUNK = 3
+};
+
+/**
+ * A chunk of a world.
+ */
+typedef struct Chunk Chunk;
+struct Chunk {
+    /** The coordinates of the chunk */
+    int cx, cy;
+
+    /** The rooms of the chunk */
+    Maze *maze;
+
+    /** The next chunk in the same hash bucket */
+    Chunk *hash_next;
+
+    /** The previous and next chunks in order of last access, starting with
+        the most recently accessed chunk */
+    Chunk *lru_previous, *lru_next;
+};
+
+struct MazeWorld {
+    /** The algorithm used to generate chunks */
+    const MazeGeneratorType *type;
+
+    /** The seed of the world */
+    uint64_t seed;
+
+    /** The width and height of a chunk */
+    unsigned int chunk_size;
+
+    /** The maximum number of chunks kept in memory, and the current number */
+    size_t max_chunks, chunk_count;
+
+    /** The hash buckets; the number of buckets is a power of two */
+    Chunk **buckets;
+    size_t bucket_mask;
+
+    /** The most and least recently accessed chunks */
+    Chunk *lru_first, *lru_last;
+
+    /** The window returned by maze_world_window */
+    Maze *window;
+};
+
+/**
+ * Derives a random number generator from the seed of a world.
+ *
+ * @param world
+ *     The world.
+ * @param cx, cy
+ *     The coordinates of the chunk.
+ * @param side
+ *     One of the SIDE_* constants.
+ * @param random
+ *     The random number generator to seed.
+ */
+static void
+derive(MazeWorld *world, uint32_t cx, uint32_t cy, int side,
+    MazeRandom *random)
+{
+    maze_random_seed(random, world->seed
+        ^ ((uint64_t)cx * 0x9e3779b97f4a7c15ULL)
+        ^ ((uint64_t)cy * 0xc2b2ae3d27d4eb4fULL)
+        ^ ((uint64_t)side << 60));
+    maze_random_next(random);
+}
+
+/**
+ * Calculates the position of the door between two chunks.
+ *
+ * @param world
+ *     The world.
+ * @param cx, cy
+ *     The coordinates of the chunk to the left of, or above, the door. They only
+ *     seed the generator, so they may wrap around.
+ * @param side
+ *     SIDE_RIGHT or SIDE_DOWN.
+ * @return the offset of the door along the edge
+ */
+static unsigned int
+door(MazeWorld *world, uint32_t cx, uint32_t cy, int side)
+{
+    MazeRandom random;
+
+    derive(world, cx, cy, side, &random);
+
+    return maze_random_range(&random, world->chunk_size);
+}
+
+/**
+ * Divides and rounds towards negative infinity.
+ *
+ * @param value
+ *     The value to divide.
+ * @param divisor
+ *     The divisor.
+ * @return the quotient
+ */
+static inline int
+floor_divide(int value, unsigned int divisor)
+{
+    return value >= 0
+        ? value / (int)divisor
+        : (int)-(long long)((-(long long)value + divisor - 1) / divisor);
+}
+
+/**
+ * Calculates the remainder of floor_divide, which is never negative.
+ *
+ * @param value
+ *     The value to divide.
+ * @param divisor
+ *     The divisor.
+ * @return the remainder
+ */
+static inline unsigned int
+floor_modulo(int value, unsigned int divisor)
+{
+    return value >= 0
+        ? (unsigned int)value % divisor
+        : divisor - 1 - (unsigned int)(-(long long)value - 1) % divisor;
+}
+
+/**
+ * Offsets a coordinate, wrapping around at the limits of int.
+ *
+ * @param value
+ *     The coordinate.
+ * @param offset
+ *     The offset to add.
+ * @return the offset coordinate
+ */
+static inline int
+offset_wrap(int value, unsigned int offset)
+{
+    unsigned int sum = (unsigned int)value + offset;
+
+    return sum <= INT_MAX ? (int)sum : -(int)(UINT_MAX - sum) - 1;
+}
+
+/**
+ * Calculates the hash bucket of a chunk.
+ *
+ * @param world
+ *     The world.
+ * @param cx, cy
+ *     The coordinates of the chunk.
+ * @return the bucket index
+ */
+static inline size_t
+bucket(MazeWorld *world, int cx, int cy)
+{
+    uint64_t hash = (uint64_t)(uint32_t)cx * 0x9e3779b97f4a7c15ULL
+        ^ (uint64_t)(uint32_t)cy * 0xc2b2ae3d27d4eb4fULL;
+
+    return (hash ^ (hash >> 32)) & world->bucket_mask;
+}
+
+/**
+ * Removes a chunk from the list of chunks in order of last access.
+ *
+ * @param world
+ *     The world.
+ * @param chunk
+ *     The chunk to remove.
+ */
+static void
+lru_remove(MazeWorld *world, Chunk *chunk)
+{
+    if (chunk->lru_previous) {
+        chunk->lru_previous->lru_next = chunk->lru_next;
+    }
+    else {
+        world->lru_first = chunk->lru_next;
+    }
+    if (chunk->lru_next) {
+        chunk->lru_next->lru_previous = chunk->lru_previous;
+    }
+    else {
+        world->lru_last = chunk->lru_previous;
+    }
+}
+
+/**
+ * Inserts a chunk first in the list of chunks in order of last access.
+ *
+ * @param world
+ *     The world.
+ * @param chunk
+ *     The chunk to insert.
+ */
+static void
+lru_insert(MazeWorld *world, Chunk *chunk)
+{
+    chunk->lru_previous = NULL;
+    chunk->lru_next = world->lru_first;
+    if (world->lru_first) {
+        world->lru_first->lru_previous = chunk;
+    }
+    else {
+        world->lru_last = chunk;
+    }
+    world->lru_first = chunk;
+}
+
+/**
+ * Releases the least recently accessed chunk.
+ *
+ * @param world
+ *     The world. It must contain at least one chunk.
+ */
+static void
+evict(MazeWorld *world)
+{
+    Chunk *chunk = world->lru_last;
+    Chunk **p;
+
+    for (p = &world->buckets[bucket(world, chunk->cx, chunk->cy)];
+            *p != chunk;
+            p = &(*p)->hash_next);
+    *p = chunk->hash_next;
+
+    lru_remove(world, chunk);
+    maze_free(chunk->maze);
+    free(chunk);
+    world->chunk_count--;
+}
+
+/**
+ * Generates the rooms of a chunk.
+ *
+ * @param world
+ *     The world.
+ * @param cx, cy
+ *     The coordinates of the chunk.
+ * @return the rooms, or NULL if memory could not be allocated or the generator
+ *     failed
+ */
+static Maze*
+generate(MazeWorld *world, int cx, int cy)
+{
+    MazeInitializeOptions options = {NULL, NULL, NULL};
+    MazeRandom random;
+    Maze *maze;
+    unsigned int last = world->chunk_size - 1;
+
+    maze = maze_create(world->chunk_size, world->chunk_size);
+    if (!maze) {
+        return NULL;
+    }
+
+    derive(world, cx, cy, SIDE_CHUNK, &random);
+    options.random = &random;
+    if (!maze_initialize(maze, world->type, &options)) {
+        maze_free(maze);
+        return NULL;
+    }
+
+    /* Open the doors to the neighbouring chunks; the position of a door is
+       derived from the chunk to the left of, or above, it */
+    maze_door_open(maze, 0, door(world, (uint32_t)cx - 1, cy, SIDE_RIGHT),
+        MAZE_WALL_LEFT);
+    maze_door_open(maze, door(world, cx, (uint32_t)cy - 1, SIDE_DOWN), 0,
+        MAZE_WALL_UP);
+    maze_door_open(maze, last, door(world, cx, cy, SIDE_RIGHT),
+        MAZE_WALL_RIGHT);
+    maze_door_open(maze, door(world, cx, cy, SIDE_DOWN), last,
+        MAZE_WALL_DOWN);
+
+    return maze;
+}
+
+/**
+ * Retrieves a chunk, generating it if it is not in memory.
+ *
+ * @param world
+ *     The world.
+ * @param cx, cy
+ *     The coordinates of the chunk.
+ * @return the rooms of the chunk, or NULL if memory could not be allocated or
+ *     the generator failed
+ */
+static Maze*
+chunk_get(MazeWorld *world, int cx, int cy)
+{
+    Chunk *chunk;
+    size_t index = bucket(world, cx, cy);
+
+    /* Repeated accesses to the same chunk are the common case */
+    if (world->lru_first
+            && world->lru_first->cx == cx && world->lru_first->cy == cy) {
+        return world->lru_first->maze;
+    }
+
+    for (chunk = world->buckets[index]; chunk; chunk = chunk->hash_next) {
+        if (chunk->cx == cx && chunk->cy == cy) {
+            lru_remove(world, chunk);
+            lru_insert(world, chunk);
+            return chunk->maze;
+        }
+    }
+
+    if (world->chunk_count >= world->max_chunks) {
+        evict(world);
+    }
+
+    chunk = malloc(sizeof(Chunk));
+    if (!chunk) {
+        return NULL;
+    }
+    chunk->maze = generate(world, cx, cy);
+    if (!chunk->maze) {
+        free(chunk);
+        return NULL;
+    }
+    chunk->cx = cx;
+    chunk->cy = cy;
+    chunk->hash_next = world->buckets[index];
+    world->buckets[index] = chunk;
+    lru_insert(world, chunk);
+    world->chunk_count++;
+
+    return chunk->maze;
+}
+
+MazeWorld*
+maze_world_create(const MazeGeneratorType *type, uint64_t seed,
+    unsigned int chunk_size, size_t max_bytes)
+{
+    MazeWorld *result;
+    size_t chunk_bytes, buckets;
+
+    if (chunk_size == 0) {
+        return NULL;
+    }
+
+    result = malloc(sizeof(MazeWorld));
+    if (!result) {
+        return NULL;
+    }
+
+    chunk_bytes = sizeof(Chunk) + sizeof(Maze)
+        + (size_t)(chunk_size + 2) * (chunk_size + 2);
+    result->type = type;
+    result->seed = seed;
+    result->chunk_size = chunk_size;
+    result->max_chunks = max_bytes / chunk_bytes ? max_bytes / chunk_bytes : 1;
+    result->chunk_count = 0;
+    result->lru_first = result->lru_last = NULL;
+    result->window = NULL;
+
+    /* Keep the load factor of the hash table below one half */
+    for (buckets = 1; buckets < 2 * result->max_chunks; buckets <<= 1);
+    result->bucket_mask = buckets - 1;
+    result->buckets = calloc(buckets, sizeof(Chunk*));
+    if (!result->buckets) {
+        free(result);
+        return NULL;
+    }
+
+    return result;
+}
+
+void
+maze_world_free(MazeWorld *world)
+{
+    while (world->chunk_count > 0) {
+        evict(world);
+    }
+    maze_free(world->window);
+    free(world->buckets);
+    free(world);
+}
+
+unsigned char
+maze_world_room_get(MazeWorld *world, int x, int y)
+{
+    int cx = floor_divide(x, world->chunk_size);
+    int cy = floor_divide(y, world->chunk_size);
+    Maze *maze = chunk_get(world, cx, cy);
+
+    if (!maze) {
+        return MAZE_WALL_ANY;
+    }
+
+    return maze_room_get(maze, floor_modulo(x, world->chunk_size),
+        floor_modulo(y, world->chunk_size));
+}
+
+Maze*
+maze_world_window(MazeWorld *world, int x, int y, unsigned int width,
+    unsigned int height)
+{
+    unsigned int wx, wy;
+
+    /* Reuse the previous window if it has the correct size */
+    if (!world->window || world->window->width != width
+            || world->window->height != height) {
+        maze_free(world->window);
+        world->window = maze_create(width, height);
+        if (!world->window) {
+            return NULL;
+        }
+    }
+
+    for (wy = 0; wy < height; wy++) {
+        for (wx = 0; wx < width; wx++) {
+            world->window->walls[maze_index(world->window, wx, wy)] =
+                maze_world_room_get(world, offset_wrap(x, wx),
+                    offset_wrap(y, wy));
+        }
+    }
+    maze_edge_update(world->window);
+
+    return world->window;
+}
@@ -0,0 +1,162 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "../maze/maze.h"
+
+/**
+ * The dimensions of the large maze; it has more than 2^32 rooms.
+ */
+#define WIDTH 65536
+#define HEIGHT 65540
+
+/**
+ * The dimensions of the band generated by every generator; it is narrow, since
+ * random walks take quadratic time in long, thin areas.
+ */
+#define BAND_WIDTH 1024
+#define BAND_HEIGHT 16
+
+/**
+ * Reports a failed check.
+ *
+ * @param condition
+ *     The condition that must hold.
+ * @param message
+ *     The description of the check.
+ * @return condition
+ */
+static int
+check(int condition, const char *message)
+{
+    if (!condition) {
+        printf("FAILED: %s\n", message);
+    }
+
+    return condition;
+}
+
+/**
+ * Checks that doors in the last row are stored at indices beyond 32 bits, and
+ * that opening them does not touch the room at the truncated index.
+ *
+ * @param maze
+ *     The large maze.
+ * @return non-zero if the checks pass
+ */
+static int
+check_alias(Maze *maze)
+{
+    int x = 100, y = HEIGHT - 1;
+    size_t index = maze_index(maze, x, y);
+    size_t alias = (uint32_t)index;
+    int ax = (int)(alias % (WIDTH + 2)) - 1;
+    int ay = (int)(alias / (WIDTH + 2)) - 1;
+    unsigned char before = maze_room_get(maze, ax, ay);
+
+    maze_door_open(maze, x, y, MAZE_WALL_RIGHT);
+    maze_door_open(maze, x, y, MAZE_WALL_UP);
+
+    return check(index > UINT32_MAX, "the last row lies beyond 32 bits")
+        && check(maze_room_get(maze, x, y) == (MAZE_WALL_RIGHT | MAZE_WALL_UP),
+            "the doors are opened in the last row")
+        && check(maze_room_get(maze, x + 1, y) == MAZE_WALL_LEFT,
+            "the door is opened in the room to the right")
+        && check(maze_room_get(maze, x, y - 1) == MAZE_WALL_DOWN,
+            "the door is opened in the room above")
+        && check(maze_room_get(maze, ax, ay) == before,
+            "the room at the truncated index is not modified");
+}
+
+/**
+ * Checks that a door out of the bottom of the maze opens the edge room below
+ * it.
+ *
+ * @param maze
+ *     The large maze.
+ * @return non-zero if the checks pass
+ */
+static int
+check_edge(Maze *maze)
+{
+    int x = WIDTH - 2, y = HEIGHT - 1;
+    unsigned char before = maze_room_get(maze, x, HEIGHT);
+
+    maze_door_open(maze, x, y, MAZE_WALL_DOWN);
+
+    return check(!(before & MAZE_WALL_UP), "the edge room is closed")
+        && check(maze_room_get(maze, x, HEIGHT) & MAZE_WALL_UP,
+            "the edge room below the maze is opened")
+        && check(maze_room_get(maze, x + 1, HEIGHT) == before,
+            "the neighbouring edge room is not modified");
+}
+
+/**
+ * Checks that every generator produces the same band of rooms at the bottom
+ * right of the large maze as in a small maze.
+ *
+ * The bands lie above the two last rows, which are modified by check_alias.
+ *
+ * @param maze
+ *     The large maze.
+ * @return non-zero if the checks pass
+ */
+static int
+check_bands(Maze *maze)
+{
+    unsigned char *buffer = malloc(2 * BAND_WIDTH);
+    const MazeGeneratorType *type;
+    unsigned int id;
+    int result = buffer != NULL;
+
+    for (id = 1; result && (type = maze_generator_type_get(id)); id++) {
+        int x0 = WIDTH - BAND_WIDTH, y0 = HEIGHT - 2 - (int)id * BAND_HEIGHT;
+        int y;
+        Maze *small = maze_create(BAND_WIDTH, BAND_HEIGHT);
+        MazeRandom random;
+
+        if (!small) {
+            result = 0;
+            break;
+        }
+
+        maze_random_seed(&random, id);
+        result = check(type->initialize_region(maze, &random, x0, y0,
+                BAND_WIDTH, BAND_HEIGHT, NULL, NULL), type->name);
+        maze_random_seed(&random, id);
+        result = result && check(type->initialize_region(small, &random, 0, 0,
+                BAND_WIDTH, BAND_HEIGHT, NULL, NULL), type->name);
+
+        for (y = 0; result && y < BAND_HEIGHT; y++) {
+            result = check(memcmp(maze_row_read(maze, x0, y0 + y, BAND_WIDTH,
+                    buffer), maze_row_read(small, 0, y, BAND_WIDTH,
+                    buffer + BAND_WIDTH), BAND_WIDTH) == 0, type->name);
+        }
+
+        maze_free(small);
+    }
+
+    free(buffer);
+
+    return result;
+}
+
+int
+main(void)
+{
+    MazeCreateOptions options = {MAZE_LAYOUT_ROWS, NULL,
+        MAZE_CREATE_HUGE_PAGES};
+    Maze *maze = maze_create_ex(WIDTH, HEIGHT, &options);
+    int result;
+
+    if (!maze) {
+        printf("large: skipped, the maze could not be allocated\n");
+        return 0;
+    }
+
+    result = check_alias(maze) && check_edge(maze) && check_bands(maze);
+    printf("large: %s\n", result ? "ok" : "FAILED");
+
+    maze_free(maze);
+
+    return !result;
+}
@@ -0,0 +1,135 @@
+#include <stdio.h>
+
+#include "../maze/maze-solve.h"
+
+/**
+ * The dimensions of the mazes to solve.
+ */
+#define SIZE 255
+
+/**
+ * Checks that a path leads from one room to another through open doors.
+ *
+ * @param maze
+ *     The maze.
+ * @param sx, sy
+ *     The coordinates of the first room.
+ * @param tx, ty
+ *     The coordinates of the last room.
+ * @param path
+ *     The path to check.
+ * @return non-zero if the path is valid
+ */
+static int
+path_check(Maze *maze, int sx, int sy, int tx, int ty, MazePath *path)
+{
+    int x = sx, y = sy;
+    size_t i;
+
+    for (i = 0; i < path->length; i++) {
+        if (!maze_door_enter(maze, &x, &y, path->steps[i], 1)) {
+            return 0;
+        }
+    }
+
+    return x == tx && y == ty;
+}
+
+/**
+ * Solves a maze with all doors open from its centre, so that the frontier
+ * outgrows the queue many times over when it is built with a small
+ * MAZE_SOLVE_QUEUE.
+ *
+ * @param workspace
+ *     The workspace to use.
+ * @param layout
+ *     The layout of the maze.
+ * @return non-zero if all paths were found and are shortest
+ */
+static int
+check_open(MazeSolveWorkspace *workspace, MazeLayout layout)
+{
+    Maze *maze = maze_create_layout(SIZE, SIZE, layout);
+    MazePath path;
+    int x, y, result = 1;
+
+    if (!maze) {
+        return 0;
+    }
+    for (y = 0; y < SIZE; y++) {
+        for (x = 0; x < SIZE; x++) {
+            maze_door_open(maze, x, y, MAZE_WALL_RIGHT);
+            maze_door_open(maze, x, y, MAZE_WALL_DOWN);
+        }
+    }
+
+    for (y = 0; y < SIZE && result; y += 17) {
+        for (x = 0; x < SIZE && result; x += 19) {
+            int distance = abs(x - SIZE / 2) + abs(y - SIZE / 2);
+
+            result = maze_solve(maze, SIZE / 2, SIZE / 2, x, y, workspace,
+                    &path)
+                && path.length == (size_t)distance
+                && path_check(maze, SIZE / 2, SIZE / 2, x, y, &path);
+        }
+    }
+
+    maze_free(maze);
+
+    return result;
+}
+
+/**
+ * Solves a perfect maze between its corners and its centre.
+ *
+ * @param workspace
+ *     The workspace to use.
+ * @param layout
+ *     The layout of the maze.
+ * @return non-zero if all paths were found
+ */
+static int
+check_perfect(MazeSolveWorkspace *workspace, MazeLayout layout)
+{
+    Maze *maze = maze_create_layout(SIZE, SIZE, layout);
+    MazeRandom random;
+    MazePath path;
+    int result;
+
+    if (!maze) {
+        return 0;
+    }
+    maze_random_seed(&random, 1);
+    maze_initialize_randomized_prim_r(maze, &random, NULL, NULL);
+
+    result = maze_solve(maze, 0, 0, SIZE - 1, SIZE - 1, workspace, &path)
+        && path_check(maze, 0, 0, SIZE - 1, SIZE - 1, &path)
+        && maze_solve(maze, SIZE / 2, SIZE / 2, 0, SIZE - 1, workspace,
+            &path)
+        && path_check(maze, SIZE / 2, SIZE / 2, 0, SIZE - 1, &path);
+
+    maze_free(maze);
+
+    return result;
+}
+
+int
+main(void)
+{
+    MazeSolveWorkspace *workspace = maze_solve_workspace_create();
+    int result;
+
+    if (!workspace) {
+        return 1;
+    }
+
+    result = check_open(workspace, MAZE_LAYOUT_ROWS)
+        && check_perfect(workspace, MAZE_LAYOUT_ROWS)
+        && check_open(workspace, MAZE_LAYOUT_TILES)
+        && check_perfect(workspace, MAZE_LAYOUT_TILES);
+    printf("maze_solve: %s\n", result ? "ok" : "FAILED");
+
+    maze_solve_workspace_free(workspace);
+
+    return !result;
+}